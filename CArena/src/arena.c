@@ -1,5 +1,35 @@
+// mmap/MAP_ANONYMOUS/madvise are not part of strict C99
+#define _DEFAULT_SOURCE
+
 #include "arena.h"
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ARENA__ATOMIC_LOAD(p)          __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ARENA__ATOMIC_STORE(p, v)      __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ARENA__ATOMIC_FETCH_ADD(p, v)  __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define ARENA__ATOMIC_CAS(p, expected, desired) \
+    __atomic_compare_exchange_n((p), (expected), (desired), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#error "ArenaAtomic needs the GCC/Clang __atomic builtins"
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define ARENA__THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define ARENA__THREAD_LOCAL __declspec(thread)
+#else
+#define ARENA__THREAD_LOCAL __thread
+#endif
 
 static const char* arena__get_err_str(ARENA_ERR err) {
     const char* err_msg;
@@ -31,6 +61,87 @@ void arena_err_fprint(FILE* stream, ARENA_ERR err) {
     fprintf(stream, "[Arena] %s", arena__get_err_str(err));
 }
 
+static void arena__stats_init(Arena* arena) {
+    arena->high_water = 0;
+#ifdef ARENA_STATS
+    memset(&arena->stats, 0, sizeof(arena->stats));
+#endif
+}
+
+static void arena__stats_alloc(Arena* arena, size_t size) {
+    if (arena->offset > arena->high_water) arena->high_water = arena->offset;
+#ifdef ARENA_STATS
+    {
+        size_t bucket = 0;
+        while (size >> bucket && bucket < ARENA_STATS_BUCKETS - 1) bucket++;
+
+        arena->stats.alloc_count++;
+        arena->stats.alloc_bytes += size;
+        arena->stats.size_histogram[bucket]++;
+    }
+#else
+    (void)size;
+#endif
+}
+
+static void arena__stats_realloc(Arena* arena, size_t old_size, size_t new_size) {
+    if (arena->offset > arena->high_water) arena->high_water = arena->offset;
+#ifdef ARENA_STATS
+    arena->stats.realloc_count++;
+    if (new_size > old_size) arena->stats.alloc_bytes += new_size - old_size;
+#else
+    (void)old_size;
+    (void)new_size;
+#endif
+}
+
+static void arena__stats_fail(Arena* arena) {
+#ifdef ARENA_STATS
+    arena->stats.failed_count++;
+#else
+    (void)arena;
+#endif
+}
+
+static void arena__stats_reset(Arena* arena) {
+#ifdef ARENA_STATS
+    arena->stats.reset_count++;
+#else
+    (void)arena;
+#endif
+}
+
+void arena_stats_fprint(FILE* stream, const Arena* arena) {
+    if (!arena) return;
+
+    fprintf(stream, "[Arena] used %zu / %zu bytes, peak %zu (%.1f%%), committed %zu\n",
+            arena->offset, arena->cap, arena->high_water,
+            arena->cap ? 100.0 * (double)arena->high_water / (double)arena->cap : 0.0,
+            arena->committed);
+#ifdef ARENA_STATS
+    {
+        size_t i;
+
+        fprintf(stream, "[Arena] %zu allocations, %zu reallocs, %zu bytes requested, %zu failed, %zu resets\n",
+                arena->stats.alloc_count, arena->stats.realloc_count, arena->stats.alloc_bytes,
+                arena->stats.failed_count, arena->stats.reset_count);
+        for (i = 0; i < ARENA_STATS_BUCKETS; ++i) {
+            size_t lo = i ? (size_t)1 << (i - 1) : 0;
+            size_t hi = (size_t)1 << i;
+
+            if (!arena->stats.size_histogram[i]) continue;
+            if (i + 1 < ARENA_STATS_BUCKETS) {
+                fprintf(stream, "[Arena]   [%zu, %zu) bytes: %zu\n", lo, hi,
+                        arena->stats.size_histogram[i]);
+            } else {
+                fprintf(stream, "[Arena]   [%zu, ...) bytes: %zu\n", lo,
+                        arena->stats.size_histogram[i]);
+            }
+        }
+    }
+#endif
+}
+
 ARENA_ERR arena_init_with_buffer(Arena* arena, void* buf, size_t cap) {
     if (!arena
      || !buf
@@ -39,13 +150,257 @@ ARENA_ERR arena_init_with_buffer(Arena* arena, void* buf, size_t cap) {
     arena->base = buf;
     arena->offset = 0;
     arena->cap = cap;
+    arena->committed = cap;
+    arena->commit_granularity = 0;
 
     arena->flags = 0;
-    arena->high_water = 0;
+    arena__stats_init(arena);
+
+    return EARENA_SUCCESS;
+}
+
+static size_t arena__page_size(void) {
+    static size_t page_size = 0;
+    if (!page_size) {
+        long ps = sysconf(_SC_PAGESIZE);
+        page_size = ps > 0 ? (size_t)ps : 4096;
+    }
+    return page_size;
+}
+
+/// round `n` up to a multiple of the power of two `granule`, 0 on overflow
+static size_t arena__round_up(size_t n, size_t granule) {
+    if (n > SIZE_MAX - (granule - 1)) return 0;
+    return (n + granule - 1) & ~(granule - 1);
+}
+
+/// map `size` bytes aligned to `align`, trimming the over-reserved head and tail
+static void* arena__map_aligned(size_t size, size_t align, int prot, int flags) {
+    byte_t* raw;
+    byte_t* aligned;
+    size_t head;
+
+    if (align <= arena__page_size()) {
+        raw = mmap(NULL, size, prot, flags, -1, 0);
+        return raw == MAP_FAILED ? NULL : raw;
+    }
+
+    if (size > SIZE_MAX - align) return NULL;
+    raw = mmap(NULL, size + align, prot, flags, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    aligned = (byte_t*)ALIGN_UP((uintptr_t)raw, (uintptr_t)align);
+    head = (size_t)(aligned - raw);
+    if (head) munmap(raw, head);
+    munmap(aligned + size, align - head);
+
+    return aligned;
+}
+
+ARENA_ERR arena_init_reserve(Arena* arena, size_t reserve, size_t commit_granularity) {
+    return arena_init_reserve_ex(arena, reserve, commit_granularity, 0);
+}
+
+ARENA_ERR arena_init_reserve_ex(Arena* arena, size_t reserve, size_t commit_granularity,
+                                uint32_t init_flags) {
+    const int anon = MAP_PRIVATE | MAP_ANONYMOUS;
+    size_t page = arena__page_size();
+    size_t committed = 0;
+    byte_t* base = NULL;
+
+    if (!arena || reserve == 0) return EARENA_INVALID_PARAM;
+
+    if (commit_granularity > (SIZE_MAX >> 1) + 1) return EARENA_INVALID_PARAM;
+    if (commit_granularity < page) commit_granularity = page;
+    // huge pages are only used for fully covered, aligned 2MB ranges
+    if ((init_flags & (ARENA_INIT_HUGEPAGE | ARENA_INIT_HUGETLB))
+     && commit_granularity < ARENA_HUGE_PAGE_SIZE) {
+        commit_granularity = ARENA_HUGE_PAGE_SIZE;
+    }
+    // granularity must be a power of two so rounding stays a mask
+    while (commit_granularity & (commit_granularity - 1))
+        commit_granularity += commit_granularity & -commit_granularity;
+
+    reserve = arena__round_up(reserve, commit_granularity);
+    if (reserve == 0) return EARENA_INVALID_PARAM;
+
+#if defined(MAP_HUGETLB)
+    // explicit huge pages come from the hugetlbfs pool, which is empty unless
+    // the admin reserved pages; fall back to transparent huge pages then
+    if (init_flags & ARENA_INIT_HUGETLB) {
+        base = arena__map_aligned(reserve, page, PROT_READ | PROT_WRITE, anon | MAP_HUGETLB);
+        if (base) {
+            committed = reserve;
+        } else {
+            init_flags |= ARENA_INIT_HUGEPAGE;
+        }
+    }
+#else
+    if (init_flags & ARENA_INIT_HUGETLB) init_flags |= ARENA_INIT_HUGEPAGE;
+#endif
+
+#if defined(MAP_POPULATE)
+    if (!base && (init_flags & ARENA_INIT_POPULATE) && !(init_flags & ARENA_INIT_HUGEPAGE)) {
+        base = arena__map_aligned(reserve, page, PROT_READ | PROT_WRITE, anon | MAP_POPULATE);
+        if (!base) return EARENA_OOM;
+        committed = reserve;
+    }
+#endif
+
+    if (!base) {
+        size_t align = (init_flags & ARENA_INIT_HUGEPAGE) ? ARENA_HUGE_PAGE_SIZE : page;
+        base = arena__map_aligned(reserve, align, PROT_NONE, anon | MAP_NORESERVE);
+        if (!base) return EARENA_OOM;
+    }
+
+#if defined(MADV_HUGEPAGE)
+    if ((init_flags & ARENA_INIT_HUGEPAGE) && !committed) {
+        madvise(base, reserve, MADV_HUGEPAGE);
+    }
+#endif
+
+    arena->base = base;
+    arena->offset = 0;
+    arena->cap = reserve;
+    arena->committed = committed;
+    arena->commit_granularity = commit_granularity;
+
+    arena->flags = ARENA_ALLOC_MEMORY_BIT;
+    arena__stats_init(arena);
+
+    // THP has to be advised before the first touch, so populate after madvise
+    if ((init_flags & ARENA_INIT_POPULATE) && !committed) {
+        return arena_prefault(arena, reserve, 1);
+    }
+
+    return EARENA_SUCCESS;
+}
+
+ARENA_ERR arena_set_decommit_on_reset(Arena* arena, int enable) {
+    if (!arena || !arena->commit_granularity) return EARENA_INVALID_PARAM;
+
+    if (enable) arena->flags |= ARENA_DECOMMIT_ON_RESET_BIT;
+    else        arena->flags &= ~ARENA_DECOMMIT_ON_RESET_BIT;
+
+    return EARENA_SUCCESS;
+}
+
+void arena_destroy(Arena* arena) {
+    if (!arena) return;
+
+    if ((arena->flags & ARENA_ALLOC_MEMORY_BIT) && arena->base) {
+        munmap(arena->base, arena->cap);
+    } else if ((arena->flags & ARENA_MAPPED_IMAGE_BIT) && arena->base) {
+        munmap(arena->base - ARENA_IMAGE_HEADER_SIZE, ARENA_IMAGE_HEADER_SIZE + arena->cap);
+    }
+
+    arena->base = NULL;
+    arena->cap = 0;
+    arena->offset = 0;
+    arena->committed = 0;
+    arena->commit_granularity = 0;
+    arena->flags = 0;
+}
+
+/// make sure [0, end) is backed by readable/writable pages, `end <= cap`
+static ARENA_ERR arena__commit(Arena* arena, size_t end) {
+    size_t target;
+
+    if (end <= arena->committed) return EARENA_SUCCESS;
+
+    // fixed buffers are fully committed, so we only get here in reserve mode
+    target = arena__round_up(end, arena->commit_granularity);
+    if (target == 0 || target > arena->cap) target = arena->cap;
+
+    if (mprotect(arena->base + arena->committed, target - arena->committed,
+                 PROT_READ | PROT_WRITE) != 0) {
+        return EARENA_OOM;
+    }
+    arena->committed = target;
+
+    return EARENA_SUCCESS;
+}
+
+typedef struct {
+    volatile byte_t* begin;
+    size_t pages;
+    size_t stride;
+} ArenaPrefaultJob;
+
+static void* arena__prefault_worker(void* arg) {
+    ArenaPrefaultJob* job = arg;
+    size_t i;
+
+#if defined(MADV_POPULATE_WRITE)
+    // one write fault per page, without touching the contents (Linux 5.14+)
+    if (madvise((void*)job->begin, job->pages * job->stride, MADV_POPULATE_WRITE) == 0) {
+        return NULL;
+    }
+#endif
+
+    // rewrite one byte per page: a read would only map the shared zero page
+    for (i = 0; i < job->pages; ++i) {
+        volatile byte_t* p = job->begin + i * job->stride;
+        *p = *p;
+    }
+
+    return NULL;
+}
+
+ARENA_ERR arena_prefault(Arena* arena, size_t size, int nthreads) {
+    ArenaPrefaultJob jobs[ARENA_PREFAULT_MAX_THREADS];
+    pthread_t threads[ARENA_PREFAULT_MAX_THREADS];
+    size_t stride, pages, per_thread;
+    int i, started;
+
+    if (!arena || !arena->base || (arena->flags & ARENA_MAPPED_IMAGE_BIT)) return EARENA_INVALID_PARAM;
+    if (size > arena->cap) size = arena->cap;
+    if (arena__commit(arena, size) != EARENA_SUCCESS) return EARENA_OOM;
+
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > ARENA_PREFAULT_MAX_THREADS) nthreads = ARENA_PREFAULT_MAX_THREADS;
+
+    stride = arena__page_size();
+    pages = (size + stride - 1) / stride;
+    per_thread = (pages + (size_t)nthreads - 1) / (size_t)nthreads;
+
+    // contiguous stripes, so each thread walks its own part of the page table
+    started = 0;
+    for (i = 0; i < nthreads; ++i) {
+        size_t first = (size_t)i * per_thread;
+        if (first >= pages) break;
+
+        jobs[i].begin = arena->base + first * stride;
+        jobs[i].pages = pages - first < per_thread ? pages - first : per_thread;
+        jobs[i].stride = stride;
+
+        if (i == nthreads - 1 || pthread_create(&threads[i], NULL, arena__prefault_worker, &jobs[i]) != 0) {
+            arena__prefault_worker(&jobs[i]); // last stripe (or no thread): do it here
+            continue;
+        }
+        started |= 1 << i;
+    }
+    for (i = 0; i < nthreads; ++i) {
+        if (started & (1 << i)) pthread_join(threads[i], NULL);
+    }
 
     return EARENA_SUCCESS;
 }
 
+/// give the pages past `keep` back to the OS; the range stays reserved
+static void arena__decommit(Arena* arena, size_t keep) {
+    size_t from = arena__round_up(keep, arena->commit_granularity);
+
+    if (from == 0 && keep != 0) return;
+    if (from >= arena->committed) return;
+
+    // MADV_DONTNEED drops the pages now, PROT_NONE catches stale pointers
+    madvise(arena->base + from, arena->committed - from, MADV_DONTNEED);
+    if (mprotect(arena->base + from, arena->committed - from, PROT_NONE) == 0) {
+        arena->committed = from;
+    }
+}
+
 ARENA_ERR arena_malloc(Arena* arena, ArenaMark* mark, size_t size) {
     if (!arena || !mark) return EARENA_INVALID_PARAM;
 #ifndef NDEBUG
@@ -53,11 +408,16 @@ ARENA_ERR arena_malloc(Arena* arena, ArenaMark* mark, size_t size) {
 #endif
 
     // overflow check
-    if (size > arena->cap - arena->offset) return EARENA_OOM;
+    if (size > arena->cap - arena->offset
+     || arena__commit(arena, arena->offset + size) != EARENA_SUCCESS) {
+        arena__stats_fail(arena);
+        return EARENA_OOM;
+    }
 
     // allocate
     *mark = arena->offset;
     arena->offset += size;
+    arena__stats_alloc(arena, size);
 
     return EARENA_SUCCESS;
 }
@@ -69,9 +429,474 @@ ARENA_ERR arena_reset_to(Arena* arena, ArenaMark mark) {
 #endif
 
     if (mark > arena->offset) return EARENA_FAILED;
+    // the pages below `offset` are read-only
+    if (arena->flags & ARENA_MAPPED_IMAGE_BIT) return EARENA_FAILED;
 
     arena->offset = mark;
+    arena__stats_reset(arena);
+
+    // keep one granule of slack so a mark/reset loop around a page boundary
+    // does not turn into a syscall per iteration
+    if (arena->flags & ARENA_DECOMMIT_ON_RESET_BIT
+     && mark <= SIZE_MAX - arena->commit_granularity) {
+        arena__decommit(arena, mark + arena->commit_granularity);
+    }
+
+    return EARENA_SUCCESS;
+}
+
+void* arena_push_aligned(Arena* arena, size_t size, size_t align) {
+    uintptr_t cur;
+    size_t pad;
+    size_t start;
+
+    if (!arena || align == 0 || (align & (align - 1))) return NULL;
+#ifndef NDEBUG
+    if (arena->cap < arena->offset) return NULL;
+#endif
+
+    cur = (uintptr_t)(arena->base + arena->offset);
+    pad = (size_t)(ALIGN_UP(cur, (uintptr_t)align) - cur);
+
+    // overflow check
+    start = arena->offset + pad;
+    if (pad > arena->cap - arena->offset
+     || size > arena->cap - start
+     || arena__commit(arena, start + size) != EARENA_SUCCESS) {
+        arena__stats_fail(arena);
+        return NULL;
+    }
+
+    arena->offset = start + size;
+    arena__stats_alloc(arena, size);
+
+    return arena->base + start;
+}
+
+/// memset that streams big blocks past the cache, so zeroing a large scratch
+/// buffer does not evict the hot working set
+static void arena__zero(void* ptr, size_t size) {
+#if defined(__SSE2__)
+    byte_t* p = ptr;
+    size_t head;
+    __m128i zero;
+
+    if (size < ARENA_NT_ZERO_THRESHOLD) {
+        memset(ptr, 0, size);
+        return;
+    }
+
+    head = (size_t)(ALIGN_UP((uintptr_t)p, (uintptr_t)16) - (uintptr_t)p);
+    memset(p, 0, head);
+    p += head;
+    size -= head;
+
+    zero = _mm_setzero_si128();
+    for (; size >= 64; size -= 64, p += 64) {
+        _mm_stream_si128((__m128i*)p + 0, zero);
+        _mm_stream_si128((__m128i*)p + 1, zero);
+        _mm_stream_si128((__m128i*)p + 2, zero);
+        _mm_stream_si128((__m128i*)p + 3, zero);
+    }
+    _mm_sfence();
+
+    memset(p, 0, size);
+#else
+    memset(ptr, 0, size);
+#endif
+}
+
+void* arena_push_zero_aligned(Arena* arena, size_t size, size_t align) {
+    void* ptr = arena_push_aligned(arena, size, align);
+    if (ptr) arena__zero(ptr, size);
+    return ptr;
+}
+
+void* arena__push_array(Arena* arena, size_t count, size_t elem_size, size_t align, int zero) {
+    if (elem_size && count > SIZE_MAX / elem_size) return NULL;
+    return zero ? arena_push_zero_aligned(arena, count * elem_size, align)
+                : arena_push_aligned(arena, count * elem_size, align);
+}
+
+ARENA_ERR arena_realloc_last(Arena* arena, ArenaMark* mark, size_t old_size, size_t new_size) {
+    byte_t* moved;
+
+    if (!arena || !mark) return EARENA_INVALID_PARAM;
+    if (*mark > arena->offset || old_size > arena->offset - *mark) return EARENA_INVALID_PARAM;
+    if (arena->flags & ARENA_MAPPED_IMAGE_BIT) return EARENA_FAILED;
+
+    if (*mark + old_size == arena->offset) {
+        if (new_size > arena->cap - *mark
+         || arena__commit(arena, *mark + new_size) != EARENA_SUCCESS) {
+            arena__stats_fail(arena);
+            return EARENA_OOM;
+        }
+        arena->offset = *mark + new_size;
+        arena__stats_realloc(arena, old_size, new_size);
+        return EARENA_SUCCESS;
+    }
+
+    if (new_size <= old_size) return EARENA_SUCCESS;
+
+    moved = arena_push_aligned(arena, new_size, ARENA_DEFAULT_ALIGN);
+    if (!moved) return EARENA_OOM;
+    memcpy(moved, arena->base + *mark, old_size);
+    *mark = (ArenaMark)(moved - arena->base);
+
+    return EARENA_SUCCESS;
+}
+
+ARENA_ERR arena_array_init(ArenaArray* arr, Arena* arena, size_t elem_size) {
+    if (!arr || !arena || elem_size == 0) return EARENA_INVALID_PARAM;
+
+    // an empty aligned block so the first growth can already happen in place
+    if (!arena_push_aligned(arena, 0, ARENA_DEFAULT_ALIGN)) return EARENA_OOM;
+
+    arr->arena = arena;
+    arr->mark = arena->offset;
+    arr->len = 0;
+    arr->cap = 0;
+    arr->elem_size = elem_size;
+
+    return EARENA_SUCCESS;
+}
+
+ARENA_ERR arena_array_reserve(ArenaArray* arr, size_t cap) {
+    ARENA_ERR err;
+
+    if (!arr) return EARENA_INVALID_PARAM;
+    if (cap <= arr->cap) return EARENA_SUCCESS;
+    if (cap > SIZE_MAX / arr->elem_size) return EARENA_OOM;
+
+    err = arena_realloc_last(arr->arena, &arr->mark,
+                             arr->cap * arr->elem_size, cap * arr->elem_size);
+    if (err != EARENA_SUCCESS) return err;
+    arr->cap = cap;
+
+    return EARENA_SUCCESS;
+}
+
+void* arena_array_push_n(ArenaArray* arr, size_t count) {
+    size_t need;
+    size_t cap;
+    void* slot;
+
+    if (!arr || count > SIZE_MAX - arr->len) return NULL;
+
+    need = arr->len + count;
+    if (need > arr->cap) {
+        cap = arr->cap > SIZE_MAX / 2 ? need : arr->cap * 2;
+        if (cap < need) cap = need;
+        if (cap < 8) cap = 8;
+        // doubling may not fit near the end of the arena, the exact size might
+        if (arena_array_reserve(arr, cap) != EARENA_SUCCESS
+         && arena_array_reserve(arr, need) != EARENA_SUCCESS) {
+            return NULL;
+        }
+    }
+
+    slot = arr->arena->base + arr->mark + arr->len * arr->elem_size;
+    arr->len = need;
+
+    return slot;
+}
+
+ARENA_ERR arena_array_append(ArenaArray* arr, const void* src, size_t count) {
+    void* dst;
+
+    if (!arr || (!src && count)) return EARENA_INVALID_PARAM;
+    if (count == 0) return EARENA_SUCCESS;
+
+    dst = arena_array_push_n(arr, count);
+    if (!dst) return EARENA_OOM;
+    memcpy(dst, src, count * arr->elem_size);
+
+    return EARENA_SUCCESS;
+}
+
+void arena_array_shrink_to_fit(ArenaArray* arr) {
+    if (!arr || arr->len == arr->cap) return;
+
+    if (arr->mark + arr->cap * arr->elem_size == arr->arena->offset) {
+        arena_realloc_last(arr->arena, &arr->mark,
+                           arr->cap * arr->elem_size, arr->len * arr->elem_size);
+        arr->cap = arr->len;
+    }
+}
+
+ARENA_ERR arena_str_append(ArenaStr* sb, const char* str, size_t len) {
+    return arena_array_append(sb, str, len);
+}
+
+ARENA_ERR arena_str_append_cstr(ArenaStr* sb, const char* str) {
+    if (!str) return EARENA_INVALID_PARAM;
+    return arena_array_append(sb, str, strlen(str));
+}
+
+const char* arena_str_cstr(ArenaStr* sb) {
+    char* term;
+
+    if (!sb) return NULL;
+
+    // the terminator lives in the spare slot after `len` and is not counted
+    term = arena_array_push_n(sb, 1);
+    if (!term) return NULL;
+    *term = '\0';
+    sb->len--;
+
+    return (const char*)(sb->arena->base + sb->mark);
+}
+
+typedef struct {
+    char magic[8];
+    uint64_t size;
+    uint64_t base_align; ///< alignment the data had when it was saved
+} ArenaImageHeader;
+
+ARENA_ERR arena_save(const Arena* arena, const char* path) {
+    static const byte_t zeros[ARENA_IMAGE_HEADER_SIZE];
+    ArenaImageHeader header;
+    uintptr_t base;
+    FILE* file;
+    int ok;
+
+    if (!arena || !arena->base || !path) return EARENA_INVALID_PARAM;
+
+    base = (uintptr_t)arena->base;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARENA_IMAGE_MAGIC, sizeof(header.magic));
+    header.size = arena->offset;
+    header.base_align = base & -base;
+    if (header.base_align > ARENA_IMAGE_HEADER_SIZE) header.base_align = ARENA_IMAGE_HEADER_SIZE;
+
+    file = fopen(path, "wb");
+    if (!file) return EARENA_FAILED;
+
+    // header padded to a page so the data is page aligned once mapped
+    ok = fwrite(&header, sizeof(header), 1, file) == 1
+      && fwrite(zeros, ARENA_IMAGE_HEADER_SIZE - sizeof(header), 1, file) == 1
+      && (arena->offset == 0 || fwrite(arena->base, arena->offset, 1, file) == 1);
+    ok = (fclose(file) == 0) && ok;
+
+    return ok ? EARENA_SUCCESS : EARENA_FAILED;
+}
+
+ARENA_ERR arena_map(const char* path, Arena* arena) {
+    ArenaImageHeader header;
+    struct stat st;
+    byte_t* map;
+    size_t size;
+    int fd;
+
+    if (!path || !arena) return EARENA_INVALID_PARAM;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return EARENA_FAILED;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < ARENA_IMAGE_HEADER_SIZE
+     || read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        close(fd);
+        return EARENA_FAILED;
+    }
+
+    if (memcmp(header.magic, ARENA_IMAGE_MAGIC, sizeof(header.magic)) != 0
+     || header.size > (uint64_t)st.st_size - ARENA_IMAGE_HEADER_SIZE
+     || header.base_align == 0 || (header.base_align & (header.base_align - 1)) != 0
+     || header.base_align > ARENA_IMAGE_HEADER_SIZE) {
+        close(fd);
+        return EARENA_INVARIANT_VIOLATION;
+    }
+    size = (size_t)header.size;
+
+    // only the image: trailing bytes in the file are not ours to map
+    map = mmap(NULL, ARENA_IMAGE_HEADER_SIZE + size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return EARENA_OOM;
+
+    // the data must land at least as aligned as it was saved
+    if ((uintptr_t)(map + ARENA_IMAGE_HEADER_SIZE) % header.base_align != 0) {
+        munmap(map, ARENA_IMAGE_HEADER_SIZE + size);
+        return EARENA_INVARIANT_VIOLATION;
+    }
+
+    arena->base = map + ARENA_IMAGE_HEADER_SIZE;
+    arena->cap = size;
+    arena->offset = size;
+    arena->committed = size;
+    arena->commit_granularity = 0;
+
+    arena->flags = ARENA_MAPPED_IMAGE_BIT;
+    arena__stats_init(arena);
+    arena->high_water = size;
+
+    return EARENA_SUCCESS;
+}
+
+ARENA_ERR frame_arena_init(FrameArena* frames, int count, size_t reserve_per_frame) {
+    ARENA_ERR err;
+    int i;
+
+    if (!frames || count < 1 || count > FRAME_ARENA_MAX_COUNT) return EARENA_INVALID_PARAM;
+
+    for (i = 0; i < count; ++i) {
+        err = arena_init_reserve(&frames->arenas[i], reserve_per_frame, 0);
+        if (err != EARENA_SUCCESS) {
+            while (i--) arena_destroy(&frames->arenas[i]);
+            return err;
+        }
+    }
+
+    frames->count = count;
+    frames->current = -1;
+    frames->frame = 0;
+
+    return EARENA_SUCCESS;
+}
+
+Arena* frame_arena_next(FrameArena* frames) {
+    Arena* arena;
+
+    if (!frames || frames->count < 1) return NULL;
+
+    frames->current = (frames->current + 1) % frames->count;
+    frames->frame++;
+
+    arena = &frames->arenas[frames->current];
+    arena_reset_to(arena, 0);
+
+    return arena;
+}
+
+Arena* frame_arena_current(FrameArena* frames) {
+    if (!frames || frames->current < 0) return NULL;
+    return &frames->arenas[frames->current];
+}
+
+Arena* frame_arena_previous(FrameArena* frames, int age) {
+    if (!frames || frames->current < 0 || age < 0 || age >= frames->count) return NULL;
+    if ((uint64_t)age >= frames->frame) return NULL;
+    return &frames->arenas[(frames->current - age + frames->count) % frames->count];
+}
+
+void frame_arena_destroy(FrameArena* frames) {
+    int i;
+
+    if (!frames) return;
+
+    for (i = 0; i < frames->count; ++i) {
+        arena_destroy(&frames->arenas[i]);
+    }
+    frames->count = 0;
+    frames->current = -1;
+}
+
+static ARENA__THREAD_LOCAL Arena arena__scratch_pool[ARENA_SCRATCH_COUNT];
+
+ArenaScratch arena_scratch_begin(Arena* const* conflicts, int n) {
+    ArenaScratch scratch = { NULL, 0 };
+    int i, j;
+
+    for (i = 0; i < ARENA_SCRATCH_COUNT; ++i) {
+        Arena* candidate = &arena__scratch_pool[i];
+        int taken = 0;
+
+        for (j = 0; j < n && !taken; ++j) {
+            taken = conflicts[j] == candidate;
+        }
+        if (taken) continue;
+
+        if (!candidate->base
+         && arena_init_reserve(candidate, ARENA_SCRATCH_RESERVE,
+                               ARENA_SCRATCH_GRANULARITY) != EARENA_SUCCESS) {
+            return scratch;
+        }
+
+        scratch.arena = candidate;
+        scratch.mark = arena_mark(candidate);
+        break;
+    }
+
+    return scratch;
+}
+
+void arena_scratch_end(ArenaScratch scratch) {
+    if (scratch.arena) arena_reset_to(scratch.arena, scratch.mark);
+}
+
+void arena_scratch_release_thread(void) {
+    int i;
+    for (i = 0; i < ARENA_SCRATCH_COUNT; ++i) {
+        arena_destroy(&arena__scratch_pool[i]);
+    }
+}
+
+ARENA_ERR arena_atomic_init_with_buffer(ArenaAtomic* arena, void* buf, size_t cap) {
+    if (!arena
+     || !buf
+     || cap <= 0) return EARENA_INVALID_PARAM;
+
+    arena->base = buf;
+    arena->cap = cap;
+    arena->flags = 0;
+    ARENA__ATOMIC_STORE(&arena->offset, (size_t)0);
+
+    return EARENA_SUCCESS;
+}
+
+ARENA_ERR arena_malloc_atomic(ArenaAtomic* arena, ArenaMark* mark, size_t size) {
+    size_t old;
+    size_t expected;
+
+    if (!arena || !mark) return EARENA_INVALID_PARAM;
+
+    // cheap early out, also keeps a full arena from drifting further past cap
+    old = ARENA__ATOMIC_LOAD(&arena->offset);
+    if (old > arena->cap || size > arena->cap - old) return EARENA_OOM;
+
+    old = ARENA__ATOMIC_FETCH_ADD(&arena->offset, size);
+    if (old > arena->cap || size > arena->cap - old) {
+        // lost the race for the tail, give the bytes back if still on top
+        expected = old + size;
+        ARENA__ATOMIC_CAS(&arena->offset, &expected, old);
+        return EARENA_OOM;
+    }
+
+    *mark = old;
+
+    return EARENA_SUCCESS;
+}
+
+ARENA_ERR arena_malloc_aligned_atomic(ArenaAtomic* arena, ArenaMark* mark, size_t size, size_t align) {
+    size_t old;
+    size_t start;
+    uintptr_t cur;
+
+    if (!arena || !mark || align == 0 || (align & (align - 1))) return EARENA_INVALID_PARAM;
+
+    old = ARENA__ATOMIC_LOAD(&arena->offset);
+    do {
+        if (old > arena->cap) return EARENA_OOM;
+
+        cur = (uintptr_t)(arena->base + old);
+        start = old + (size_t)(ALIGN_UP(cur, (uintptr_t)align) - cur);
+        if (start > arena->cap || size > arena->cap - start) return EARENA_OOM;
+    } while (!ARENA__ATOMIC_CAS(&arena->offset, &old, start + size));
+
+    *mark = start;
 
     return EARENA_SUCCESS;
 }
 
+ARENA_ERR arena_atomic_reset_to(ArenaAtomic* arena, ArenaMark mark) {
+    if (!arena) return EARENA_INVALID_PARAM;
+
+    if (mark > ARENA__ATOMIC_LOAD(&arena->offset)) return EARENA_FAILED;
+
+    ARENA__ATOMIC_STORE(&arena->offset, mark);
+
+    return EARENA_SUCCESS;
+}
+
+size_t arena_atomic_used(const ArenaAtomic* arena) {
+    size_t offset = ARENA__ATOMIC_LOAD(&arena->offset);
+    return offset < arena->cap ? offset : arena->cap;
+}
@@ -5,6 +5,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // ==== MEMORY MANAGEMENT
 // Here are the memory macro definitions, which users can override with their
 // own implementions
@@ -20,17 +24,56 @@ typedef enum {
     EARENA_MAXNUM,
 } ARENA_ERR;
 
-#define ARENA_ALLOC_MEMORY_BIT (1u<<1)
+#define ARENA_ALLOC_MEMORY_BIT      (1u<<1) ///< arena owns `base`, release with arena_destroy
+#define ARENA_DECOMMIT_ON_RESET_BIT (1u<<2) ///< arena_reset_to gives pages back to the OS
+#define ARENA_MAPPED_IMAGE_BIT      (1u<<3) ///< read-only image from arena_map
+
+/// round `offset` up to a multiple of `align`, which must be a power of two
+#define ALIGN_UP(offset, align) (((offset) + ((align) - 1)) & ~((align) - 1))
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define ARENA_ALIGNOF(T) _Alignof(T)
+#elif defined(__GNUC__)
+#define ARENA_ALIGNOF(T) __alignof__(T)
+#else
+#define ARENA_ALIGNOF(T) offsetof(struct { char c; T t; }, t)
+#endif
+
+/// alignment used by arena_push, enough for any scalar and SSE vectors
+#define ARENA_DEFAULT_ALIGN 16
+/// zeroing blocks at least this big bypasses the cache (non-temporal stores)
+#define ARENA_NT_ZERO_THRESHOLD (256u * 1024u)
 
-#define ALIGN_UP(offset, align) (offset + align)
+// ==== STATISTICS
+// Build with -DARENA_STATS (everywhere arena.h is included, it changes the
+// layout of Arena) to record allocation counts, a power-of-two size histogram,
+// failures and resets. `high_water` is tracked in every build. In-place
+// resizes by arena_realloc_last count as reallocs, not allocations; growth
+// adds only the extra bytes to `alloc_bytes`.
+
+#define ARENA_STATS_BUCKETS 40 ///< bucket 0: size 0, bucket i: [2^(i-1), 2^i)
+
+typedef struct {
+    size_t alloc_count;
+    size_t alloc_bytes;  ///< sum of requested sizes
+    size_t realloc_count; ///< in-place resizes of the newest allocation
+    size_t failed_count;
+    size_t reset_count;
+    size_t size_histogram[ARENA_STATS_BUCKETS];
+} ArenaStats;
 
 typedef struct {
     byte_t* base;
-    size_t cap;
+    size_t cap;       ///< reserved bytes in reserve mode
     size_t offset;
+    size_t committed; ///< readable/writable prefix of `base`
+    size_t commit_granularity; ///< 0 for fixed buffers
 
     uint32_t flags;
-    uint32_t high_water; ///< peak
+    size_t high_water; ///< peak offset
+#ifdef ARENA_STATS
+    ArenaStats stats;
+#endif
 } Arena;
 
 typedef size_t ArenaMark;
@@ -39,9 +82,228 @@ static inline ArenaMark arena_mark(Arena* a) { return a->offset; }
 
 // debugging tools
 void      arena_err_fprint(FILE* stream, ARENA_ERR);
+/// peak usage, and with ARENA_STATS the counters and size histogram
+void      arena_stats_fprint(FILE* stream, const Arena* arena);
 
 ARENA_ERR arena_init_with_buffer(Arena* arena, void* buf, size_t cap);
+/// Reserve `reserve` bytes of address space up front and commit pages in steps
+/// of `commit_granularity` (rounded up to the page size, 0 = one page) as the
+/// offset grows. `base` never moves, so marks and pointers stay valid.
+ARENA_ERR arena_init_reserve(Arena* arena, size_t reserve, size_t commit_granularity);
+
+// arena_init_reserve_ex flags, Linux only, ignored elsewhere
+#define ARENA_INIT_HUGEPAGE (1u<<0) ///< 2MB-align and madvise(MADV_HUGEPAGE), commits in 2MB steps
+#define ARENA_INIT_HUGETLB  (1u<<1) ///< MAP_HUGETLB, fully committed; falls back to HUGEPAGE
+#define ARENA_INIT_POPULATE (1u<<2) ///< commit and fault in the whole reserve up front
+
+#define ARENA_HUGE_PAGE_SIZE        ((size_t)2 << 20)
+#define ARENA_PREFAULT_MAX_THREADS  32
+
+ARENA_ERR arena_init_reserve_ex(Arena* arena, size_t reserve, size_t commit_granularity,
+                                uint32_t init_flags);
+/// Commit [0, size) and touch every page from `nthreads` threads so the
+/// first-touch faults happen before the arena goes into service. Must not run
+/// while other threads use the arena.
+ARENA_ERR arena_prefault(Arena* arena, size_t size, int nthreads);
+/// Toggle ARENA_DECOMMIT_ON_RESET_BIT on a reserve-mode arena. When set,
+/// arena_reset_to releases the committed pages past the mark (keeping one
+/// granule of slack) so RSS drops after peak phases.
+ARENA_ERR arena_set_decommit_on_reset(Arena* arena, int enable);
+void      arena_destroy(Arena* arena);
+
 ARENA_ERR arena_malloc(Arena* arena, ArenaMark* mark, size_t size);
 ARENA_ERR arena_reset_to(Arena* arena, ArenaMark mark);
 
+// ==== POINTER API
+// Alignment is applied to the address, not the offset, so it holds for any
+// `base`. All functions return NULL on OOM or a non power of two `align`.
+
+void* arena_push_aligned(Arena* arena, size_t size, size_t align);
+void* arena_push_zero_aligned(Arena* arena, size_t size, size_t align);
+void* arena__push_array(Arena* arena, size_t count, size_t elem_size, size_t align, int zero);
+
+#define arena_push(arena, size) \
+    arena_push_aligned((arena), (size), ARENA_DEFAULT_ALIGN)
+#define arena_push_zero(arena, size) \
+    arena_push_zero_aligned((arena), (size), ARENA_DEFAULT_ALIGN)
+#define arena_push_struct(arena, T) \
+    ((T*)arena_push_aligned((arena), sizeof(T), ARENA_ALIGNOF(T)))
+#define arena_push_struct_zero(arena, T) \
+    ((T*)arena_push_zero_aligned((arena), sizeof(T), ARENA_ALIGNOF(T)))
+#define arena_push_array(arena, T, n) \
+    ((T*)arena__push_array((arena), (n), sizeof(T), ARENA_ALIGNOF(T), 0))
+#define arena_push_array_zero(arena, T, n) \
+    ((T*)arena__push_array((arena), (n), sizeof(T), ARENA_ALIGNOF(T), 1))
+
+/// Resize the block at `*mark` from `old_size` to `new_size` bytes. If it is
+/// the most recent allocation it grows or shrinks in place; otherwise a new
+/// ARENA_DEFAULT_ALIGN block is pushed, the data copied and `*mark` updated.
+ARENA_ERR arena_realloc_last(Arena* arena, ArenaMark* mark, size_t old_size, size_t new_size);
+
+// ==== GROWABLE CONTAINERS
+// Arrays and string builders that live in an arena and grow through
+// arena_realloc_last: the newest container extends in place, older ones
+// move to the top once and keep growing from there.
+
+typedef struct {
+    Arena* arena;
+    ArenaMark mark;
+    size_t len;
+    size_t cap;
+    size_t elem_size;
+} ArenaArray;
+
+ARENA_ERR arena_array_init(ArenaArray* arr, Arena* arena, size_t elem_size);
+ARENA_ERR arena_array_reserve(ArenaArray* arr, size_t cap);
+/// append `count` uninitialised elements, NULL on OOM
+void*     arena_array_push_n(ArenaArray* arr, size_t count);
+ARENA_ERR arena_array_append(ArenaArray* arr, const void* src, size_t count);
+/// give unused capacity back when the array is on top of its arena
+void      arena_array_shrink_to_fit(ArenaArray* arr);
+
+#define arena_array_data(arr, T) ((T*)((arr)->arena->base + (arr)->mark))
+#define arena_array_at(arr, T, i) (arena_array_data((arr), T) + (i))
+#define arena_array_push(arr, T) ((T*)arena_array_push_n((arr), 1))
+
+typedef ArenaArray ArenaStr;
+
+#define arena_str_init(sb, arena) arena_array_init((sb), (arena), 1)
+#define arena_str_len(sb) ((sb)->len)
+ARENA_ERR arena_str_append(ArenaStr* sb, const char* str, size_t len);
+ARENA_ERR arena_str_append_cstr(ArenaStr* sb, const char* str);
+/// NUL-terminated view of the builder, valid until the next append
+const char* arena_str_cstr(ArenaStr* sb);
+
+// ==== PERSISTENT IMAGES
+// arena_save writes the used part of an arena to a file; arena_map maps such a
+// file read-only, so a structure built once (symbol table, parsed config) is
+// loaded on the next start without any deserialisation. The mapped arena is
+// full (`offset == cap`) and cannot be reset; release it with arena_destroy.
+//
+// Data inside the image must not hold raw pointers. Use ArenaMark offsets or
+// ARENA_REL self-relative pointers, which survive the move to a new address.
+// Alignment is preserved up to the alignment of the saved arena's base
+// (reserve-mode arenas are page aligned), at most ARENA_IMAGE_HEADER_SIZE.
+
+#define ARENA_IMAGE_MAGIC       "CARENA\x00\x01"
+#define ARENA_IMAGE_HEADER_SIZE 4096
+
+ARENA_ERR arena_save(const Arena* arena, const char* path);
+ARENA_ERR arena_map(const char* path, Arena* arena);
+
+/// Self-relative pointer, stores `target - &rel` and 0 for NULL.
+typedef int64_t ArenaRelOffset;
+#define ARENA_REL(T) ArenaRelOffset
+
+static inline void arena_rel_set(ArenaRelOffset* rel, const void* target) {
+    *rel = target ? (ArenaRelOffset)((const byte_t*)target - (const byte_t*)rel) : 0;
+}
+
+static inline void* arena_rel_get(const ArenaRelOffset* rel) {
+    return *rel ? (void*)((const byte_t*)rel + *rel) : NULL;
+}
+
+#define ARENA_REL_SET(rel, ptr) arena_rel_set(&(rel), (ptr))
+#define ARENA_REL_GET(T, rel)   ((T*)arena_rel_get(&(rel)))
+
+// ==== FRAME ARENAS
+// A ring of reserve-mode arenas for per-frame transient data (vertices,
+// uniforms, command lists). frame_arena_next() moves to the next arena and
+// resets it in O(1), so with `count` arenas the data of the last `count - 1`
+// frames stays valid while the new frame is built:
+//
+//     FrameArena frames;
+//     frame_arena_init(&frames, FRAME_ARENA_DEFAULT_COUNT, 64 << 20);
+//     for (;;) {
+//         Arena* frame = frame_arena_next(&frames);
+//         Vertex* verts = arena_push_array(frame, Vertex, n);
+//         ...   // GPU may still read frame_arena_previous(&frames, 1)
+//     }
+//     frame_arena_destroy(&frames);
+
+#define FRAME_ARENA_MAX_COUNT     4
+#define FRAME_ARENA_DEFAULT_COUNT 2
+
+typedef struct {
+    Arena arenas[FRAME_ARENA_MAX_COUNT];
+    int count;
+    int current;    ///< -1 before the first frame_arena_next
+    uint64_t frame; ///< number of frame_arena_next calls
+} FrameArena;
+
+ARENA_ERR frame_arena_init(FrameArena* frames, int count, size_t reserve_per_frame);
+/// start a new frame, returns its (empty) arena
+Arena*    frame_arena_next(FrameArena* frames);
+Arena*    frame_arena_current(FrameArena* frames);
+/// arena of the frame `age` frames ago, NULL if it has been recycled
+Arena*    frame_arena_previous(FrameArena* frames, int age);
+void      frame_arena_destroy(FrameArena* frames);
+
+// ==== SCRATCH ARENAS
+// Each thread owns a small ring of reserve-mode arenas, created on first use.
+// A function that allocates its result in `out` and needs temporaries asks for
+// a scratch arena that is not `out`:
+//
+//     ArenaScratch tmp = arena_scratch_begin(&out, 1);
+//     ... arena_push(tmp.arena, ...) ...
+//     arena_scratch_end(tmp);
+//
+// Nested calls pass the arenas they are already using as conflicts, so the
+// inner scope never resets memory the outer scope still owns.
+
+#define ARENA_SCRATCH_COUNT       2
+#define ARENA_SCRATCH_RESERVE     ((size_t)64 << 20)
+#define ARENA_SCRATCH_GRANULARITY ((size_t)64 << 10)
+
+typedef struct {
+    Arena* arena;   ///< NULL if every scratch arena conflicts or mmap failed
+    ArenaMark mark;
+} ArenaScratch;
+
+ArenaScratch arena_scratch_begin(Arena* const* conflicts, int n);
+void         arena_scratch_end(ArenaScratch scratch);
+/// unmap the calling thread's scratch arenas, e.g. before the thread exits
+void         arena_scratch_release_thread(void);
+
+// ==== CONCURRENT ARENA
+// Multi-producer bump allocation over a fixed buffer. Allocation is lock-free;
+// reset is not and must only happen while no thread is allocating.
+//
+// Unaligned requests are a single fetch-add. A request that overshoots `cap`
+// fails with EARENA_OOM and tries to hand its bytes back; if another thread
+// bumped in the meantime the tail stays consumed, so `offset` may exceed `cap`
+// until the next reset (arena_atomic_used clamps it).
+
+typedef struct {
+    byte_t* base;
+    size_t cap;
+    size_t offset; ///< only accessed atomically
+
+    uint32_t flags;
+} ArenaAtomic;
+
+ARENA_ERR arena_atomic_init_with_buffer(ArenaAtomic* arena, void* buf, size_t cap);
+ARENA_ERR arena_malloc_atomic(ArenaAtomic* arena, ArenaMark* mark, size_t size);
+/// CAS loop so the padding is only consumed by the request that wins
+ARENA_ERR arena_malloc_aligned_atomic(ArenaAtomic* arena, ArenaMark* mark, size_t size, size_t align);
+ARENA_ERR arena_atomic_reset_to(ArenaAtomic* arena, ArenaMark mark);
+size_t    arena_atomic_used(const ArenaAtomic* arena);
+
+#ifdef __cplusplus
+}
+
+/// Typed self-relative pointer, layout compatible with ARENA_REL(T).
+template <typename T>
+struct ArenaRel {
+    ArenaRelOffset off;
+
+    T*   get() const { return static_cast<T*>(arena_rel_get(&off)); }
+    void set(const T* target) { arena_rel_set(&off, target); }
+
+    T* operator->() const { return get(); }
+    T& operator*() const { return *get(); }
+    explicit operator bool() const { return off != 0; }
+};
+#endif
+
 #endif // ARENA_H
@@ -0,0 +1,394 @@
+// clock_gettime/posix_memalign are POSIX, not C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "arena.h"
+
+enum { KB = 1u << 10, MB = 1u << 20 };
+
+typedef struct {
+    float x, y, z, w;
+} Vec4;
+
+// keeps the optimiser from deleting allocations nobody reads
+static volatile uintptr_t bench_sink;
+
+static double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench_report(const char* name, double ns, size_t ops) {
+    printf("  %-28s %8.2f ns/op\n", name, ns / (double)ops);
+}
+
+// ==== push vs malloc
+
+enum { PUSH_ROUNDS = 200, PUSH_COUNT = 10000 };
+
+static void bench_push_small(Arena* arena) {
+    static void* ptrs[PUSH_COUNT];
+    double t0;
+    int r, i;
+
+    printf("small objects (%d x 32B per round)\n", PUSH_COUNT);
+
+    t0 = bench_now_ns();
+    for (r = 0; r < PUSH_ROUNDS; ++r) {
+        ArenaMark m = arena_mark(arena);
+        for (i = 0; i < PUSH_COUNT; ++i) {
+            Vec4* v = arena_push_array(arena, Vec4, 2);
+            bench_sink += (uintptr_t)v;
+        }
+        arena_reset_to(arena, m);
+    }
+    bench_report("arena_push_array", bench_now_ns() - t0, (size_t)PUSH_ROUNDS * PUSH_COUNT);
+
+    t0 = bench_now_ns();
+    for (r = 0; r < PUSH_ROUNDS; ++r) {
+        for (i = 0; i < PUSH_COUNT; ++i) {
+            ptrs[i] = malloc(2 * sizeof(Vec4));
+            bench_sink += (uintptr_t)ptrs[i];
+        }
+        for (i = 0; i < PUSH_COUNT; ++i) free(ptrs[i]);
+    }
+    bench_report("malloc + free", bench_now_ns() - t0, (size_t)PUSH_ROUNDS * PUSH_COUNT);
+}
+
+static void bench_push_mixed(Arena* arena) {
+    static void* ptrs[PUSH_COUNT];
+    static size_t sizes[PUSH_COUNT];
+    unsigned seed = 12345u;
+    double t0;
+    int r, i;
+
+    for (i = 0; i < PUSH_COUNT; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        sizes[i] = 8u + (seed >> 16) % 1024u;
+    }
+
+    printf("mixed sizes (8B..1KB, 64B aligned)\n");
+
+    t0 = bench_now_ns();
+    for (r = 0; r < PUSH_ROUNDS; ++r) {
+        ArenaMark m = arena_mark(arena);
+        for (i = 0; i < PUSH_COUNT; ++i) {
+            bench_sink += (uintptr_t)arena_push_aligned(arena, sizes[i], 64);
+        }
+        arena_reset_to(arena, m);
+    }
+    bench_report("arena_push_aligned", bench_now_ns() - t0, (size_t)PUSH_ROUNDS * PUSH_COUNT);
+
+    t0 = bench_now_ns();
+    for (r = 0; r < PUSH_ROUNDS; ++r) {
+        for (i = 0; i < PUSH_COUNT; ++i) {
+            if (posix_memalign(&ptrs[i], 64, sizes[i]) != 0) ptrs[i] = NULL;
+            bench_sink += (uintptr_t)ptrs[i];
+        }
+        for (i = 0; i < PUSH_COUNT; ++i) free(ptrs[i]);
+    }
+    bench_report("posix_memalign + free", bench_now_ns() - t0, (size_t)PUSH_ROUNDS * PUSH_COUNT);
+}
+
+static void bench_push_zero(Arena* arena) {
+    enum { ZERO_ROUNDS = 50 };
+    const size_t sizes[] = { 4 * KB, 64 * KB, 1 * MB, 16 * MB };
+    size_t s;
+    double t0;
+    int r;
+
+    printf("zeroed blocks\n");
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        char name[64];
+
+        t0 = bench_now_ns();
+        for (r = 0; r < ZERO_ROUNDS; ++r) {
+            ArenaMark m = arena_mark(arena);
+            bench_sink += (uintptr_t)arena_push_zero(arena, sizes[s]);
+            arena_reset_to(arena, m);
+        }
+        snprintf(name, sizeof(name), "arena_push_zero %zuKB", sizes[s] / KB);
+        bench_report(name, bench_now_ns() - t0, ZERO_ROUNDS);
+
+        t0 = bench_now_ns();
+        for (r = 0; r < ZERO_ROUNDS; ++r) {
+            void* p = calloc(1, sizes[s]);
+            bench_sink += (uintptr_t)p;
+            free(p);
+        }
+        snprintf(name, sizeof(name), "calloc %zuKB", sizes[s] / KB);
+        bench_report(name, bench_now_ns() - t0, ZERO_ROUNDS);
+    }
+}
+
+static int bench_push(void) {
+    Arena arena = {0};
+    ARENA_ERR err = arena_init_reserve(&arena, 256 * MB, 0);
+
+    if (err != EARENA_SUCCESS) {
+        arena_err_fprint(stderr, err);
+        fputc('\n', stderr);
+        return 1;
+    }
+
+    bench_push_small(&arena);
+    bench_push_mixed(&arena);
+    bench_push_zero(&arena);
+
+    arena_destroy(&arena);
+    return 0;
+}
+
+// ==== contention: mutex-wrapped Arena vs ArenaAtomic
+
+enum { CONTENTION_MAX_THREADS = 64, CONTENTION_ALLOCS = 20000, CONTENTION_SIZE = 24 };
+
+typedef enum {
+    CONTENTION_MUTEX,
+    CONTENTION_ATOMIC,
+    CONTENTION_ATOMIC_ALIGNED,
+} ContentionMode;
+
+typedef struct {
+    ContentionMode mode;
+    Arena* arena;
+    pthread_mutex_t* lock;
+    ArenaAtomic* atomic;
+    pthread_barrier_t* start;
+} ContentionCtx;
+
+typedef struct {
+    ContentionCtx* ctx;
+    double begin_ns;
+    double end_ns;
+} ContentionThread;
+
+static void* contention_worker(void* arg) {
+    ContentionThread* self = arg;
+    ContentionCtx* ctx = self->ctx;
+    ArenaMark mark = 0;
+    int i;
+
+    pthread_barrier_wait(ctx->start);
+    self->begin_ns = bench_now_ns();
+
+    for (i = 0; i < CONTENTION_ALLOCS; ++i) {
+        switch (ctx->mode) {
+        case CONTENTION_MUTEX:
+            pthread_mutex_lock(ctx->lock);
+            arena_malloc(ctx->arena, &mark, CONTENTION_SIZE);
+            pthread_mutex_unlock(ctx->lock);
+            break;
+        case CONTENTION_ATOMIC:
+            arena_malloc_atomic(ctx->atomic, &mark, CONTENTION_SIZE);
+            break;
+        case CONTENTION_ATOMIC_ALIGNED:
+            arena_malloc_aligned_atomic(ctx->atomic, &mark, CONTENTION_SIZE, 16);
+            break;
+        }
+        bench_sink += mark;
+    }
+
+    self->end_ns = bench_now_ns();
+    return NULL;
+}
+
+static double contention_run(ContentionCtx* ctx, int nthreads) {
+    pthread_t threads[CONTENTION_MAX_THREADS];
+    ContentionThread self[CONTENTION_MAX_THREADS];
+    pthread_barrier_t start;
+    double begin, end;
+    int i;
+
+    pthread_barrier_init(&start, NULL, (unsigned)nthreads);
+    ctx->start = &start;
+
+    for (i = 0; i < nthreads; ++i) {
+        self[i].ctx = ctx;
+        pthread_create(&threads[i], NULL, contention_worker, &self[i]);
+    }
+    for (i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // span from the first worker starting to the last one finishing, so
+    // thread creation and scheduling of the main thread are not counted
+    begin = self[0].begin_ns;
+    end = self[0].end_ns;
+    for (i = 1; i < nthreads; ++i) {
+        if (self[i].begin_ns < begin) begin = self[i].begin_ns;
+        if (self[i].end_ns > end) end = self[i].end_ns;
+    }
+
+    pthread_barrier_destroy(&start);
+    return end - begin;
+}
+
+static int bench_contention(void) {
+    const size_t cap = (size_t)CONTENTION_MAX_THREADS * CONTENTION_ALLOCS * (CONTENTION_SIZE + 16);
+    byte_t* buffer = malloc(cap);
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    Arena arena;
+    ArenaAtomic atomic;
+    ContentionCtx ctx;
+    int nthreads;
+
+    if (!buffer) return 1;
+    memset(buffer, 0, cap); // fault the pages in outside the timed region
+
+    arena_init_with_buffer(&arena, buffer, cap);
+    arena_atomic_init_with_buffer(&atomic, buffer, cap);
+    ctx.arena = &arena;
+    ctx.lock = &lock;
+    ctx.atomic = &atomic;
+
+    printf("  %-8s %14s %14s %14s   (ns per allocation, wall clock)\n",
+           "threads", "mutex", "fetch-add", "cas-aligned");
+
+    for (nthreads = 1; nthreads <= CONTENTION_MAX_THREADS; nthreads *= 2) {
+        const size_t ops = (size_t)nthreads * CONTENTION_ALLOCS;
+        double t_mutex, t_atomic, t_aligned;
+
+        ctx.mode = CONTENTION_MUTEX;
+        arena_reset_to(&arena, 0);
+        t_mutex = contention_run(&ctx, nthreads);
+
+        ctx.mode = CONTENTION_ATOMIC;
+        arena_atomic_reset_to(&atomic, 0);
+        t_atomic = contention_run(&ctx, nthreads);
+
+        ctx.mode = CONTENTION_ATOMIC_ALIGNED;
+        arena_atomic_reset_to(&atomic, 0);
+        t_aligned = contention_run(&ctx, nthreads);
+
+        printf("  %-8d %14.2f %14.2f %14.2f\n", nthreads,
+               t_mutex / (double)ops, t_atomic / (double)ops, t_aligned / (double)ops);
+    }
+
+    pthread_mutex_destroy(&lock);
+    free(buffer);
+    return 0;
+}
+
+// ==== prefault: first-touch faults and TLB reach on a large arena
+
+enum { PREFAULT_THREADS = 4, PREFAULT_PROBES = 4000000 };
+
+typedef struct {
+    const char* name;
+    uint32_t init_flags;
+    int prefault_threads; ///< 0: fault lazily while touching
+} PrefaultMode;
+
+static size_t prefault_size(void) {
+    const char* env = getenv("ARENA_BENCH_PREFAULT_MB");
+    size_t mb = env ? (size_t)strtoul(env, NULL, 10) : 0;
+    return (mb ? mb : 1024) * MB;
+}
+
+/// random reads over the whole block: with 4KB pages nearly every probe
+/// misses the TLB, with 2MB pages far fewer do
+static double prefault_random_read(const byte_t* base, size_t size) {
+    unsigned long long seed = 0x9E3779B97F4A7C15ull;
+    uintptr_t sum = 0;
+    double t0;
+    int i;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < PREFAULT_PROBES; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        sum += base[(size_t)(seed >> 17) % size];
+    }
+    bench_sink += sum;
+    return (bench_now_ns() - t0) / PREFAULT_PROBES;
+}
+
+static int bench_prefault(void) {
+    const PrefaultMode modes[] = {
+        { "lazy",                 0,                   0 },
+        { "populate",             ARENA_INIT_POPULATE, 0 },
+        { "prefault x1",          0,                   1 },
+        { "prefault x4",          0,                   PREFAULT_THREADS },
+        { "hugepage lazy",        ARENA_INIT_HUGEPAGE, 0 },
+        { "hugepage prefault x4", ARENA_INIT_HUGEPAGE, PREFAULT_THREADS },
+        { "hugetlb",              ARENA_INIT_HUGETLB,  0 },
+    };
+    const size_t size = prefault_size();
+    size_t m;
+
+    printf("  %zuMB arena, write one byte per 4KB page after init/prefault\n", size / MB);
+    printf("  %-22s %10s %10s %10s %14s\n",
+           "mode", "init ms", "touch ms", "total ms", "rand ns/read");
+
+    for (m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        Arena arena = {0};
+        ARENA_ERR err;
+        byte_t* p;
+        double t0, t_init, t_touch;
+        size_t off;
+
+        t0 = bench_now_ns();
+        err = arena_init_reserve_ex(&arena, size, 0, modes[m].init_flags);
+        if (err == EARENA_SUCCESS && modes[m].prefault_threads) {
+            err = arena_prefault(&arena, size, modes[m].prefault_threads);
+        }
+        t_init = bench_now_ns() - t0;
+        if (err != EARENA_SUCCESS) {
+            arena_err_fprint(stderr, err);
+            fputc('\n', stderr);
+            return 1;
+        }
+
+        // the push commits lazily in reserve mode, then the loop pays any faults left
+        t0 = bench_now_ns();
+        p = arena_push(&arena, size);
+        for (off = 0; p && off < size; off += 4 * KB) p[off] = 1;
+        t_touch = bench_now_ns() - t0;
+        if (!p) return 1;
+
+        printf("  %-22s %10.1f %10.1f %10.1f %14.2f\n", modes[m].name,
+               t_init / 1e6, t_touch / 1e6, (t_init + t_touch) / 1e6,
+               prefault_random_read(p, size));
+
+        arena_destroy(&arena);
+    }
+
+    return 0;
+}
+
+typedef struct {
+    const char* name;
+    int (*run)(void);
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+    { "push",       bench_push },
+    { "contention", bench_contention },
+    { "prefault",   bench_prefault },
+};
+
+int main(int argc, char** argv) {
+    size_t i;
+    int status = 0;
+    int ran = 0;
+
+    for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); ++i) {
+        if (argc > 1 && strcmp(argv[1], bench_cases[i].name) != 0) continue;
+        printf("== %s\n", bench_cases[i].name);
+        status |= bench_cases[i].run();
+        ran = 1;
+    }
+
+    if (!ran) {
+        fprintf(stderr, "unknown benchmark '%s'\n", argv[1]);
+        return 1;
+    }
+
+    return status;
+}
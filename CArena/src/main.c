@@ -1,10 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <pthread.h>
 #include "arena.h"
 
-int main() {
-    enum { KB = 1u << 10, MB = 1u << 20 };
+enum { KB = 1u << 10, MB = 1u << 20 };
+
+static void test_with_buffer(void) {
     void* buffer = malloc(1 * MB);  // 1MB
 
     Arena arena = {0};
@@ -43,9 +46,551 @@ int main() {
     err = arena_reset_to(&arena, mark[0]);
     assert(err == EARENA_SUCCESS);
     assert(arena.offset == 0);
+    assert(arena.high_water == 2 * KB);
 
-    printf("Success! All tests have been passed!\n");
+#ifdef ARENA_STATS
+    assert(arena.stats.alloc_count == 3);
+    assert(arena.stats.alloc_bytes == 2 * KB);
+    assert(arena.stats.failed_count == 1);
+    assert(arena.stats.reset_count == 3);
+    assert(arena.stats.size_histogram[0] == 1);  // 0 bytes
+    assert(arena.stats.size_histogram[11] == 2); // [1KB, 2KB)
+    arena_stats_fprint(stdout, &arena);
+#endif
+
+    free(buffer);
+}
+
+static void test_reserve(void) {
+    Arena arena = {0};
+    ArenaMark mark[4] = {0};
+    ARENA_ERR err;
+    byte_t* base;
+
+    err = arena_init_reserve(&arena, 64 * MB, 64 * KB);
+    assert(err == EARENA_SUCCESS);
+    assert(arena.flags & ARENA_ALLOC_MEMORY_BIT);
+    assert(arena.cap == 64 * MB);
+    assert(arena.committed == 0);
+    base = arena.base;
+
+    err = arena_malloc(&arena, &mark[0], 1 * KB);
+    assert(err == EARENA_SUCCESS && mark[0] == 0);
+    assert(arena.committed == 64 * KB);
+    arena.base[mark[0]] = 0xAB;
+
+    // grows across many granules without moving base
+    err = arena_malloc(&arena, &mark[1], 8 * MB);
+    assert(err == EARENA_SUCCESS && mark[1] == 1 * KB);
+    assert(arena.base == base);
+    assert(arena.committed >= arena.offset);
+    arena.base[mark[1] + 8 * MB - 1] = 0xCD;
+    assert(arena.base[mark[0]] == 0xAB);
+
+    err = arena_malloc(&arena, &mark[2], 64 * MB);
+    assert(err == EARENA_OOM);
+
+    // without the policy reset keeps the pages
+    err = arena_reset_to(&arena, mark[1]);
+    assert(err == EARENA_SUCCESS);
+    assert(arena.committed > 8 * MB);
+
+    err = arena_malloc(&arena, &mark[1], 8 * MB);
+    assert(err == EARENA_SUCCESS);
+
+    err = arena_set_decommit_on_reset(&arena, 1);
+    assert(err == EARENA_SUCCESS);
+    err = arena_reset_to(&arena, mark[1]);
+    assert(err == EARENA_SUCCESS);
+    assert(arena.committed == 128 * KB);
+    assert(arena.base[mark[0]] == 0xAB);
+
+    // decommitted pages come back zeroed on the next commit
+    err = arena_malloc(&arena, &mark[1], 8 * MB);
+    assert(err == EARENA_SUCCESS);
+    assert(arena.base[mark[1] + 8 * MB - 1] == 0);
+
+    err = arena_set_decommit_on_reset(&arena, 0);
+    assert(err == EARENA_SUCCESS);
+
+    arena_destroy(&arena);
+    assert(arena.base == NULL && arena.cap == 0);
+}
+
+static void test_reserve_ex(void) {
+    Arena arena = {0};
+    ArenaMark mark = 0;
+    ARENA_ERR err;
+
+    // huge pages: 2MB aligned base and granularity, whether or not THP is on
+    err = arena_init_reserve_ex(&arena, 3 * MB, 0, ARENA_INIT_HUGEPAGE);
+    assert(err == EARENA_SUCCESS);
+    assert(((uintptr_t)arena.base & (ARENA_HUGE_PAGE_SIZE - 1)) == 0);
+    assert(arena.commit_granularity == ARENA_HUGE_PAGE_SIZE);
+    assert(arena.cap == 4 * MB);
+    err = arena_malloc(&arena, &mark, 1);
+    assert(err == EARENA_SUCCESS && arena.committed == 2 * MB);
+    arena_destroy(&arena);
+
+    // hugetlb falls back to THP when the pool is empty; either way it maps
+    err = arena_init_reserve_ex(&arena, 2 * MB, 0, ARENA_INIT_HUGETLB);
+    assert(err == EARENA_SUCCESS);
+    err = arena_malloc(&arena, &mark, 2 * MB);
+    assert(err == EARENA_SUCCESS);
+    arena.base[mark + 2 * MB - 1] = 1;
+    arena_destroy(&arena);
+
+    err = arena_init_reserve_ex(&arena, 1 * MB, 0, ARENA_INIT_POPULATE);
+    assert(err == EARENA_SUCCESS);
+    assert(arena.committed == arena.cap);
+    arena_destroy(&arena);
+
+    // prefault keeps data already in the arena
+    err = arena_init_reserve(&arena, 8 * MB, 0);
+    assert(err == EARENA_SUCCESS);
+    err = arena_malloc(&arena, &mark, 1 * KB);
+    assert(err == EARENA_SUCCESS);
+    arena.base[mark] = 0x5A;
+    err = arena_prefault(&arena, 6 * MB, 4);
+    assert(err == EARENA_SUCCESS);
+    assert(arena.committed >= 6 * MB);
+    assert(arena.base[mark] == 0x5A);
+    assert(arena.base[6 * MB - 1] == 0);
+    arena_destroy(&arena);
+}
+
+static void test_push_aligned(void) {
+    static byte_t buffer[4 * KB];
+
+    Arena arena = {0};
+    ARENA_ERR err;
+    byte_t* p;
+    double* d;
+    int* ints;
+    size_t i;
+
+    assert(ALIGN_UP(32u, 16u) == 32u);
+    assert(ALIGN_UP(33u, 16u) == 48u);
+    assert(ALIGN_UP(7u, 1u) == 7u);
+    assert(ALIGN_UP(1u, 8u) == 8u);
+
+    // offset the base so alignment has to be applied to the address
+    err = arena_init_with_buffer(&arena, buffer + 1, sizeof(buffer) - 1);
+    assert(err == EARENA_SUCCESS);
+
+    p = arena_push_aligned(&arena, 3, 1);
+    assert(p == arena.base && arena.offset == 3);
+
+    p = arena_push_aligned(&arena, 64, 64);
+    assert(p && (uintptr_t)p % 64 == 0);
+
+    assert(arena_push_aligned(&arena, 8, 24) == NULL);
+    assert(arena_push_aligned(&arena, 8, 0) == NULL);
+
+    d = arena_push_struct(&arena, double);
+    assert(d && (uintptr_t)d % ARENA_ALIGNOF(double) == 0);
+
+    ints = arena_push_array_zero(&arena, int, 100);
+    assert(ints && (uintptr_t)ints % ARENA_ALIGNOF(int) == 0);
+    for (i = 0; i < 100; ++i) assert(ints[i] == 0);
+
+    assert(arena_push_array(&arena, int, SIZE_MAX / 2) == NULL);
+    assert(arena_push(&arena, 4 * KB) == NULL);
+
+    err = arena_reset_to(&arena, 0);
+    assert(err == EARENA_SUCCESS);
+    p = arena_push(&arena, 16);
+    assert(p && (uintptr_t)p % ARENA_DEFAULT_ALIGN == 0);
+}
+
+static void test_push_zero_large(void) {
+    Arena arena = {0};
+    ARENA_ERR err;
+    byte_t* p;
+    size_t i;
+
+    err = arena_init_reserve(&arena, 16 * MB, 0);
+    assert(err == EARENA_SUCCESS);
+
+    // dirty the pages so the zeroing has something to do
+    p = arena_push(&arena, 4 * MB);
+    assert(p);
+    memset(p, 0xFF, 4 * MB);
+    err = arena_reset_to(&arena, 0);
+    assert(err == EARENA_SUCCESS);
+
+    p = arena_push_zero_aligned(&arena, 4 * MB - 3, 1);
+    assert(p);
+    for (i = 0; i < 4 * MB - 3; ++i) assert(p[i] == 0);
+
+    arena_destroy(&arena);
+}
+
+static void test_realloc_last(void) {
+    static byte_t buffer[4 * KB];
+
+    Arena arena = {0};
+    ArenaMark a, b, moved;
+    ARENA_ERR err;
+
+    err = arena_init_with_buffer(&arena, buffer, sizeof(buffer));
+    assert(err == EARENA_SUCCESS);
+
+    err = arena_malloc(&arena, &a, 16);
+    assert(err == EARENA_SUCCESS);
+    memset(arena.base + a, 'a', 16);
+
+    // top allocation grows and shrinks in place
+    err = arena_realloc_last(&arena, &a, 16, 64);
+    assert(err == EARENA_SUCCESS && a == 0 && arena.offset == 64);
+    err = arena_realloc_last(&arena, &a, 64, 32);
+    assert(err == EARENA_SUCCESS && a == 0 && arena.offset == 32);
+    assert(arena.high_water == 64);
+
+#ifdef ARENA_STATS
+    // in-place resizes are not new allocations; growth adds only the delta
+    assert(arena.stats.alloc_count == 1 && arena.stats.realloc_count == 2);
+    assert(arena.stats.alloc_bytes == 64);
+#endif
+
+    err = arena_realloc_last(&arena, &a, 32, 8 * KB);
+    assert(err == EARENA_OOM && arena.offset == 32);
+
+    // not on top any more: copied to a new block
+    err = arena_malloc(&arena, &b, 8);
+    assert(err == EARENA_SUCCESS);
+    moved = a;
+    err = arena_realloc_last(&arena, &moved, 16, 128);
+    assert(err == EARENA_SUCCESS && moved > b);
+    assert(memcmp(arena.base + moved, arena.base + a, 16) == 0);
+    assert((uintptr_t)(arena.base + moved) % ARENA_DEFAULT_ALIGN == 0);
+
+    b = arena.offset - 8;
+    err = arena_realloc_last(&arena, &b, 16, 32);
+    assert(err == EARENA_INVALID_PARAM);
+}
+
+static void test_containers(void) {
+    Arena arena = {0};
+    ArenaArray ints, other;
+    ArenaStr sb;
+    ArenaMark first;
+    ARENA_ERR err;
+    double* d;
+    int* n;
+    int i;
+
+    err = arena_init_reserve(&arena, 16 * MB, 0);
+    assert(err == EARENA_SUCCESS);
+
+    err = arena_array_init(&ints, &arena, sizeof(int));
+    assert(err == EARENA_SUCCESS);
+    for (i = 0; i < 10000; ++i) {
+        *arena_array_push(&ints, int) = i;
+    }
+    first = ints.mark;
+    assert(ints.len == 10000 && ints.cap >= 10000);
+    // newest container never moved
+    assert(ints.mark == first);
+    for (i = 0; i < 10000; ++i) assert(*arena_array_at(&ints, int, i) == i);
+
+    arena_array_shrink_to_fit(&ints);
+    assert(ints.cap == ints.len);
+    assert(arena.offset == ints.mark + ints.len * sizeof(int));
+
+    // a second container pushes `ints` off the top: one move, then in place
+    err = arena_array_init(&other, &arena, sizeof(double));
+    assert(err == EARENA_SUCCESS);
+    d = arena_array_push(&other, double);
+    assert(d);
+    n = arena_array_push(&ints, int);
+    assert(n);
+    assert(ints.mark != first);
+    first = ints.mark;
+    err = arena_array_append(&ints, arena_array_data(&ints, int), 100);
+    assert(err == EARENA_SUCCESS);
+    assert(ints.mark == first && ints.len == 10101);
+    assert(*arena_array_at(&ints, int, 10100) == 99);
+
+    err = arena_str_init(&sb, &arena);
+    assert(err == EARENA_SUCCESS);
+    err = arena_str_append_cstr(&sb, "hello");
+    assert(err == EARENA_SUCCESS);
+    err = arena_str_append(&sb, ", world!!", 7);
+    assert(err == EARENA_SUCCESS);
+    assert(strcmp(arena_str_cstr(&sb), "hello, world") == 0);
+    assert(arena_str_len(&sb) == 12);
+    err = arena_str_append_cstr(&sb, "?");
+    assert(err == EARENA_SUCCESS);
+    assert(strcmp(arena_str_cstr(&sb), "hello, world?") == 0);
+
+    arena_destroy(&arena);
+}
+
+typedef struct Symbol {
+    uint32_t id;
+    ARENA_REL(const char) name;
+    ARENA_REL(struct Symbol) next;
+} Symbol;
+
+static void test_image(void) {
+    static const char* names[] = { "alpha", "beta", "gamma" };
+    const char* path = "target/test_image.arena";
+    Arena arena = {0}, mapped = {0};
+    Symbol* head = NULL;
+    Symbol* sym;
+    ArenaMark mark;
+    ARENA_ERR err;
+    FILE* file;
+    uint32_t i;
+
+    err = arena_init_reserve(&arena, 1 * MB, 0);
+    assert(err == EARENA_SUCCESS);
+
+    for (i = 0; i < 3; ++i) {
+        size_t len = strlen(names[i]) + 1;
+        char* name = arena_push_array(&arena, char, len);
+        memcpy(name, names[i], len);
+
+        sym = arena_push_struct(&arena, Symbol);
+        sym->id = i;
+        ARENA_REL_SET(sym->name, name);
+        ARENA_REL_SET(sym->next, head);
+        head = sym;
+    }
+    // the list head is stored as a plain offset at a well-known place
+    mark = (ArenaMark)((byte_t*)head - arena.base);
+    *arena_push_struct(&arena, ArenaMark) = mark;
+
+    err = arena_save(&arena, path);
+    assert(err == EARENA_SUCCESS);
+    // bytes past the image are not part of it
+    file = fopen(path, "ab");
+    assert(file);
+    fputs("trailing", file);
+    fclose(file);
+    err = arena_map(path, &mapped);
+    assert(err == EARENA_SUCCESS);
+    assert(mapped.flags & ARENA_MAPPED_IMAGE_BIT);
+    assert(mapped.offset == arena.offset && mapped.base != arena.base);
+    assert((uintptr_t)mapped.base % ARENA_IMAGE_HEADER_SIZE == 0);
+    arena_destroy(&arena);
+
+    mark = *(ArenaMark*)(mapped.base + mapped.offset - sizeof(ArenaMark));
+    sym = (Symbol*)(mapped.base + mark);
+    for (i = 3; i-- > 0; sym = ARENA_REL_GET(Symbol, sym->next)) {
+        assert(sym && sym->id == i);
+        assert(strcmp(ARENA_REL_GET(const char, sym->name), names[i]) == 0);
+    }
+    assert(sym == NULL);
+
+    // mapped images are read-only and full
+    sym = arena_push(&mapped, 1);
+    assert(sym == NULL);
+    err = arena_reset_to(&mapped, 0);
+    assert(err == EARENA_FAILED);
+
+    arena_destroy(&mapped);
+    remove(path);
+
+    err = arena_map("target/does-not-exist.arena", &mapped);
+    assert(err == EARENA_FAILED);
+}
+
+static void test_frame_arena(void) {
+    FrameArena frames;
+    Arena* frame;
+    int* prev_data = NULL;
+    ARENA_ERR err;
+    int f;
+
+    err = frame_arena_init(&frames, 0, 1 * MB);
+    assert(err == EARENA_INVALID_PARAM);
+    err = frame_arena_init(&frames, FRAME_ARENA_MAX_COUNT + 1, 1 * MB);
+    assert(err == EARENA_INVALID_PARAM);
+    err = frame_arena_init(&frames, 3, 1 * MB);
+    assert(err == EARENA_SUCCESS);
+    assert(frame_arena_current(&frames) == NULL);
+
+    for (f = 0; f < 10; ++f) {
+        int* data;
+
+        frame = frame_arena_next(&frames);
+        assert(frame && frame == frame_arena_current(&frames));
+        assert(arena_mark(frame) == 0);
+        assert(frame_arena_previous(&frames, 0) == frame);
+        assert(frame_arena_previous(&frames, 3) == NULL);
+
+        data = arena_push_array(frame, int, 256);
+        data[0] = f;
+
+        // data written one and two frames ago is still intact
+        if (f >= 1) {
+            assert(prev_data[0] == f - 1);
+            assert(frame_arena_previous(&frames, 1) != frame);
+        } else {
+            assert(frame_arena_previous(&frames, 1) == NULL);
+        }
+        if (f >= 2) {
+            int* old = (int*)(frame_arena_previous(&frames, 2)->base);
+            assert(old[0] == f - 2);
+        }
+        prev_data = data;
+    }
+    assert(frames.frame == 10);
+
+    frame_arena_destroy(&frames);
+}
+
+/// builds "<prefix>-<n>" in `out`, using scratch memory for the digits
+static char* scratch_format(Arena* out, const char* prefix, unsigned n) {
+    ArenaScratch tmp = arena_scratch_begin(&out, 1);
+    size_t len = strlen(prefix);
+    char* digits;
+    char* result;
+    int count = 0;
+
+    assert(tmp.arena && tmp.arena != out);
+    digits = arena_push_array(tmp.arena, char, 16);
+    do {
+        digits[count++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n);
+
+    result = arena_push_array(out, char, len + (size_t)count + 2);
+    memcpy(result, prefix, len);
+    result[len] = '-';
+    while (count) result[++len] = digits[--count];
+    result[len + 1] = '\0';
+
+    arena_scratch_end(tmp);
+    return result;
+}
+
+static void* scratch_worker(void* arg) {
+    ArenaScratch a = arena_scratch_begin(NULL, 0);
+    *(Arena**)arg = a.arena;
+    arena_scratch_end(a);
+    arena_scratch_release_thread();
+    return NULL;
+}
+
+static void test_scratch(void) {
+    ArenaScratch outer, inner;
+    Arena* other_thread = NULL;
+    pthread_t thread;
+    ArenaMark before;
+    char* s;
+    void* p;
+
+    outer = arena_scratch_begin(NULL, 0);
+    assert(outer.arena && outer.mark == 0);
+    before = arena_mark(outer.arena);
+
+    // the callee sees the caller's arena as a conflict and picks another one
+    s = scratch_format(outer.arena, "frame", 1024);
+    assert(strcmp(s, "frame-1024") == 0);
+
+    inner = arena_scratch_begin(&outer.arena, 1);
+    assert(inner.arena && inner.arena != outer.arena);
+    p = arena_push(inner.arena, 128);
+    assert(p);
+    arena_scratch_end(inner);
+    assert(arena_mark(inner.arena) == inner.mark);
+
+    // both ring slots conflict
+    {
+        Arena* both[2] = { outer.arena, inner.arena };
+        assert(arena_scratch_begin(both, 2).arena == NULL);
+    }
+
+    assert(arena_mark(outer.arena) > before);
+    arena_scratch_end(outer);
+    assert(arena_mark(outer.arena) == 0);
+
+    pthread_create(&thread, NULL, scratch_worker, &other_thread);
+    pthread_join(thread, NULL);
+    assert(other_thread && other_thread != outer.arena && other_thread != inner.arena);
+
+    arena_scratch_release_thread();
+}
+
+enum { ATOMIC_THREADS = 8, ATOMIC_ALLOCS = 1000 };
+
+static void* atomic_worker(void* arg) {
+    ArenaAtomic* arena = arg;
+    ArenaMark mark;
+    int i;
+
+    for (i = 0; i < ATOMIC_ALLOCS; ++i) {
+        size_t align = (size_t)8 << (i % 3);
+        ARENA_ERR err = (i & 1) ? arena_malloc_atomic(arena, &mark, 24)
+                                : arena_malloc_aligned_atomic(arena, &mark, 24, align);
+        assert(err == EARENA_SUCCESS);
+        assert((i & 1) || (uintptr_t)(arena->base + mark) % align == 0);
+        // every byte must be handed out exactly once
+        memset(arena->base + mark, 1, 24);
+        assert(arena->base[mark] == 1);
+    }
+
+    return NULL;
+}
+
+static void test_atomic(void) {
+    enum { CAP = ATOMIC_THREADS * ATOMIC_ALLOCS * 64 };
+    byte_t* buffer = calloc(1, CAP);
+    pthread_t threads[ATOMIC_THREADS];
+    ArenaAtomic arena;
+    ArenaMark mark;
+    ARENA_ERR err;
+    size_t i, used;
+
+    err = arena_atomic_init_with_buffer(&arena, buffer, CAP);
+    assert(err == EARENA_SUCCESS);
+
+    err = arena_malloc_atomic(&arena, &mark, 10);
+    assert(err == EARENA_SUCCESS && mark == 0);
+    err = arena_malloc_aligned_atomic(&arena, &mark, 8, 16);
+    assert(err == EARENA_SUCCESS && (uintptr_t)(arena.base + mark) % 16 == 0);
+    err = arena_malloc_aligned_atomic(&arena, &mark, 8, 3);
+    assert(err == EARENA_INVALID_PARAM);
+
+    err = arena_malloc_atomic(&arena, &mark, CAP);
+    assert(err == EARENA_OOM);
+    assert(arena_atomic_used(&arena) == mark + 8);
+
+    err = arena_atomic_reset_to(&arena, 0);
+    assert(err == EARENA_SUCCESS);
+
+    for (i = 0; i < ATOMIC_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, atomic_worker, &arena);
+    }
+    for (i = 0; i < ATOMIC_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    used = 0;
+    for (i = 0; i < CAP; ++i) used += buffer[i];
+    assert(used == (size_t)ATOMIC_THREADS * ATOMIC_ALLOCS * 24);
+    assert(arena_atomic_used(&arena) <= CAP);
 
     free(buffer);
+}
+
+int main() {
+    test_with_buffer();
+    test_reserve();
+    test_reserve_ex();
+    test_push_aligned();
+    test_push_zero_large();
+    test_realloc_last();
+    test_containers();
+    test_image();
+    test_frame_arena();
+    test_atomic();
+    test_scratch();
+
+    printf("Success! All tests have been passed!\n");
+
     return 0;
 }
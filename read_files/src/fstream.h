@@ -6,6 +6,8 @@
 #include <thread>
 #include <vector>
 
+#include "read_buffers.h"
+
 inline void read_with_ifstream(const std::string_view filename)
 {
     std::ifstream file(filename.data(), std::ios::binary);
@@ -20,14 +22,19 @@ inline void read_with_ifstream(const std::string_view filename)
     std::streamsize file_size = file.tellg();
     file.seekg(0, std::ios::beg);
 
-    char* buffer = new char[file_size];
+    if (!read_buffers_init(1, file_size)) {
+        std::cerr << "Error reserving read buffer" << std::endl;
+        return;
+    }
+    char* buffer = (char*)read_buffers_alloc(file_size);
     file.read(buffer, file_size);
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "ifstream read time: " << duration.count() << " ms" << std::endl;
 
-    delete[] buffer;
+    read_buffers_free(buffer, file_size);
+    read_buffers_destroy();
     file.close();
 }
 
@@ -62,9 +69,14 @@ inline void read_in_parallel(const std::string_view filename, size_t chunk_size,
     size_t remaining_bytes = file_size % chunk_size;
 
     // Allocate buffers for each thread
+    size_t buffer_size = chunk_size + remaining_bytes; // Extra space for potential remaining bytes
+    if (!read_buffers_init(num_threads, buffer_size)) {
+        std::cerr << "Error reserving read buffers" << std::endl;
+        return;
+    }
     std::vector<char*> buffers(num_threads);
     for (int i = 0; i < num_threads; ++i) {
-        buffers[i] = new char[chunk_size + remaining_bytes]; // Extra space for potential remaining bytes
+        buffers[i] = (char*)read_buffers_alloc(buffer_size);
     }
 
     auto start = std::chrono::high_resolution_clock::now();
@@ -105,6 +117,7 @@ inline void read_in_parallel(const std::string_view filename, size_t chunk_size,
 
     // Clean up buffers
     for (int i = 0; i < num_threads; ++i) {
-        delete[] buffers[i];
+        read_buffers_free(buffers[i], buffer_size);
     }
+    read_buffers_destroy();
 }
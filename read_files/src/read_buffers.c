@@ -0,0 +1,38 @@
+#include "read_buffers.h"
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+enum { READ_BUFFER_MIN_BLOCK = 64 * 1024, READ_BUFFER_ALIGN = 64 };
+
+static TL_BuddyAllocator g_buddy;
+
+int read_buffers_init(size_t count, size_t size)
+{
+    size_t block = READ_BUFFER_MIN_BLOCK;
+
+    if (count == 0 || size == 0) return 0;
+    // every buffer is a whole max_block, so `count` of them always fit
+    while (block < size) {
+        if (block > SIZE_MAX / 2) return 0;
+        block *= 2;
+    }
+    if (count > SIZE_MAX / block) return 0;
+
+    return tl_buddy_init_mapped(&g_buddy, count * block, READ_BUFFER_MIN_BLOCK, block);
+}
+
+void* read_buffers_alloc(size_t size)
+{
+    return tl_buddy_alloc(&g_buddy, size, READ_BUFFER_ALIGN);
+}
+
+void read_buffers_free(void* ptr, size_t size)
+{
+    tl_buddy_free(&g_buddy, ptr, size, READ_BUFFER_ALIGN);
+}
+
+void read_buffers_destroy(void)
+{
+    tl_buddy_destroy(&g_buddy);
+}
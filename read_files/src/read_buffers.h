@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+
+// Buffers for large file reads, carved from one tinylib buddy allocator
+// instead of one heap allocation each. tinylib is C only, so it lives behind
+// this small C interface (read_buffers.c).
+//
+// Not thread-safe: init, alloc, free and destroy from one thread; the
+// buffers themselves may be filled from any thread.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// room for `count` buffers of up to `size` bytes each; 0 on failure
+int   read_buffers_init(size_t count, size_t size);
+void* read_buffers_alloc(size_t size);
+void  read_buffers_free(void* ptr, size_t size);
+void  read_buffers_destroy(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,7 +2,10 @@ add_rules("mode.debug", "mode.release")
 
 target("readfiles")
     set_kind("binary")
-    add_files("src/*.cpp")
+    -- read_buffers.c wraps tinylib, which is GNU C only
+    set_languages("gnu11")
+    add_files("src/*.cpp", "src/*.c")
+    add_includedirs("../wasm_scene/c/include")
 
 --
 -- If you want to known more usage about xmake, please see https://xmake.io
@@ -0,0 +1,487 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * alloc_bench.c
+ *   Allocator benchmark: CArena, TL_Arena, TL_FixedPool and glibc malloc.
+ *
+ *   Usage:
+ *     ./build bench                      (builds and runs everything)
+ *     target/bench/alloc_bench [workload]
+ *
+ *   Every (workload, allocator) pair runs in a forked child so RSS is not
+ *   polluted by what earlier runs left in the heap. Columns:
+ *
+ *     ns/op     wall time / (allocs + frees); arena frees are no-op calls
+ *     p50..max  latency of sampled single allocations, timer cost removed
+ *     rss MB    peak resident growth over the workload
+ *     overhead  rss / peak live bytes requested (1.00 = no waste)
+ *
+ *   Arenas and the pool are not thread-safe; the threaded workloads share
+ *   one instance of them behind a mutex, malloc is called directly.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "arena.h"
+
+#include "bench_common.h"
+
+#define BENCH_SAMPLE_EVERY   16
+#define BENCH_MAX_SAMPLES    (1 << 20)
+#define BENCH_THREADS        4
+
+/* ==== allocators under test */
+
+typedef struct BenchAllocator {
+    const char *name;
+    b32_t (*init)(size_t max_size);
+    void *(*alloc)(size_t size);
+    void  (*free)(void *ptr, size_t size);
+    void  (*reset)(void);
+    void  (*destroy)(void);
+    b32_t thread_safe;
+} BenchAllocator;
+
+static b32_t bench_malloc_init(size_t max_size) { (void)max_size; return 1; }
+static void *bench_malloc_alloc(size_t size) { return malloc(size); }
+static void  bench_malloc_free(void *ptr, size_t size) { (void)size; free(ptr); }
+static void  bench_malloc_reset(void) {}
+static void  bench_malloc_destroy(void) {}
+
+static Arena bench_carena;
+
+static b32_t bench_carena_init(size_t max_size)
+{
+    (void)max_size;
+    return arena_init_reserve(&bench_carena, 4096 * BENCH_MB, 0) == EARENA_SUCCESS;
+}
+static void *bench_carena_alloc(size_t size) { return arena_push(&bench_carena, size); }
+static void  bench_carena_free(void *ptr, size_t size)
+{
+    /* a stack arena can give back the top allocation, nothing else; pushes
+     * are 16-aligned, so the top block may be followed by padding */
+    byte_t *end = (byte_t *)ptr + ALIGN_UP(size, (size_t)ARENA_DEFAULT_ALIGN);
+    if (end >= bench_carena.base + bench_carena.offset) {
+        arena_reset_to(&bench_carena, (ArenaMark)((byte_t *)ptr - bench_carena.base));
+    }
+}
+static void  bench_carena_reset(void) { arena_reset_to(&bench_carena, 0); }
+static void  bench_carena_destroy(void) { arena_destroy(&bench_carena); }
+
+static TL_Arena bench_tl_arena;
+
+static b32_t bench_tl_arena_init(size_t max_size) { (void)max_size; return 1; }
+static void *bench_tl_arena_alloc(size_t size) { return tl_arena_alloc(&bench_tl_arena, size); }
+static void  bench_tl_arena_free(void *ptr, size_t size) { (void)ptr; (void)size; }
+static void  bench_tl_arena_reset(void) { tl_arena_reset(&bench_tl_arena); }
+static void  bench_tl_arena_destroy(void) { tl_arena_destroy(&bench_tl_arena); }
+
+static TL_FixedPool bench_pool;
+
+/* one pool sized for the largest request: mixed sizes show up as overhead */
+static b32_t bench_pool_init(size_t max_size)
+{
+    return tl_fixed_pool_init(&bench_pool, max_size, TL_MEM_ALIGN, 1024);
+}
+static void *bench_pool_alloc(size_t size) { return tl_fixed_pool_alloc(&bench_pool, size, TL_MEM_ALIGN); }
+static void  bench_pool_free(void *ptr, size_t size) { (void)size; tl_fixed_pool_free(&bench_pool, ptr); }
+static void  bench_pool_reset(void) {}
+static void  bench_pool_destroy(void) { tl_fixed_pool_destroy(&bench_pool); }
+
+static const BenchAllocator bench_allocators[] = {
+    { "malloc",        bench_malloc_init,   bench_malloc_alloc,   bench_malloc_free,
+      bench_malloc_reset,   bench_malloc_destroy,   1 },
+    { "carena",        bench_carena_init,   bench_carena_alloc,   bench_carena_free,
+      bench_carena_reset,   bench_carena_destroy,   0 },
+    { "tl_arena",      bench_tl_arena_init, bench_tl_arena_alloc, bench_tl_arena_free,
+      bench_tl_arena_reset, bench_tl_arena_destroy, 0 },
+    { "tl_fixed_pool", bench_pool_init,     bench_pool_alloc,     bench_pool_free,
+      bench_pool_reset,     bench_pool_destroy,     0 },
+};
+
+/* ==== measurement context */
+
+typedef struct BenchRun {
+    const BenchAllocator *a;
+    pthread_mutex_t lock;
+    b32_t locked;            /* wrap calls in `lock` (threaded, not thread-safe) */
+
+    double *samples;
+    size_t samples_count;    /* shared by threads, claimed atomically */
+    double timer_ns;
+
+    size_t ops;              /* allocs + frees */
+    size_t peak_live;        /* bytes, set by the workload */
+    long rss_base_kb;
+    long rss_peak_kb;
+} BenchRun;
+
+typedef struct BenchThread {
+    BenchRun *run;
+    size_t counter;
+    size_t live;
+    size_t peak_live;
+} BenchThread;
+
+static void
+bench_rss_probe(BenchRun *run)
+{
+    long rss = bench_rss_kb();
+    if (rss > run->rss_peak_kb) run->rss_peak_kb = rss;
+}
+
+static inline
+void *
+bench_alloc(BenchThread *t, size_t size)
+{
+    BenchRun *run = t->run;
+    double t0 = 0.0;
+    b32_t sample = (++t->counter % BENCH_SAMPLE_EVERY) == 0;
+    void *p;
+
+    if (sample) t0 = bench_now_ns();
+    if (run->locked) pthread_mutex_lock(&run->lock);
+    p = run->a->alloc(size);
+    if (run->locked) pthread_mutex_unlock(&run->lock);
+    if (sample) {
+        double dt = bench_now_ns() - t0 - run->timer_ns;
+        size_t i = __atomic_fetch_add(&run->samples_count, 1, __ATOMIC_RELAXED);
+        if (i < BENCH_MAX_SAMPLES) run->samples[i] = dt > 0.0 ? dt : 0.0;
+    }
+
+    if (!p) {
+        fprintf(stderr, "%s: out of memory (%zu bytes)\n", run->a->name, size);
+        exit(1);
+    }
+    /* touch it, like a real caller would */
+    *(volatile byte_t *)p = 1;
+
+    t->live += size;
+    if (t->live > t->peak_live) t->peak_live = t->live;
+    return p;
+}
+
+static inline
+void
+bench_free(BenchThread *t, void *ptr, size_t size)
+{
+    BenchRun *run = t->run;
+
+    if (run->locked) pthread_mutex_lock(&run->lock);
+    run->a->free(ptr, size);
+    if (run->locked) pthread_mutex_unlock(&run->lock);
+    t->live -= size;
+}
+
+/* ==== workloads */
+
+typedef struct BenchWorkload {
+    const char *name;
+    const char *desc;
+    size_t max_size;
+    void (*run)(BenchRun *run);
+} BenchWorkload;
+
+enum {
+    SMALL_COUNT = 200000, SMALL_ROUNDS = 10, SMALL_SIZE = 32,
+    MIXED_COUNT = 50000,  MIXED_ROUNDS = 10, MIXED_MIN = 16, MIXED_MAX = 2048,
+    LIFO_OPS = 2000000,   LIFO_DEPTH = 64,   LIFO_POP = 48,  LIFO_MAX = 256,
+    PC_COUNT = 400000,    PC_RING = 1024,    PC_SIZE = 64,
+    MT_COUNT = 1000,      MT_ROUNDS = 50,    MT_MIN = 16,    MT_MAX = 128,
+};
+
+static void
+bench_small(BenchRun *run)
+{
+    void **ptrs = malloc(SMALL_COUNT * sizeof(*ptrs));
+    BenchThread t = { .run = run };
+    int r, i;
+
+    for (r = 0; r < SMALL_ROUNDS; ++r) {
+        for (i = 0; i < SMALL_COUNT; ++i) ptrs[i] = bench_alloc(&t, SMALL_SIZE);
+        if (r == 0) bench_rss_probe(run);
+        for (i = 0; i < SMALL_COUNT; ++i) bench_free(&t, ptrs[i], SMALL_SIZE);
+        run->a->reset();
+    }
+
+    run->ops = (size_t)SMALL_ROUNDS * SMALL_COUNT * 2;
+    run->peak_live = t.peak_live;
+    free(ptrs);
+}
+
+static void
+bench_mixed(BenchRun *run)
+{
+    void **ptrs = malloc(MIXED_COUNT * sizeof(*ptrs));
+    size_t *sizes = malloc(MIXED_COUNT * sizeof(*sizes));
+    int *order = malloc(MIXED_COUNT * sizeof(*order));
+    BenchThread t = { .run = run };
+    uint64_t seed = 0x1234567ULL;
+    int r, i;
+
+    for (i = 0; i < MIXED_COUNT; ++i) {
+        sizes[i] = MIXED_MIN + (size_t)(bench_rand(&seed) % (MIXED_MAX - MIXED_MIN + 1));
+        order[i] = i;
+    }
+    /* free in a shuffled order so holes form everywhere */
+    for (i = MIXED_COUNT - 1; i > 0; --i) {
+        int j = (int)(bench_rand(&seed) % (uint64_t)(i + 1));
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    for (r = 0; r < MIXED_ROUNDS; ++r) {
+        for (i = 0; i < MIXED_COUNT; ++i) ptrs[i] = bench_alloc(&t, sizes[i]);
+        if (r == 0) bench_rss_probe(run);
+        for (i = 0; i < MIXED_COUNT; ++i) bench_free(&t, ptrs[order[i]], sizes[order[i]]);
+        run->a->reset();
+    }
+
+    run->ops = (size_t)MIXED_ROUNDS * MIXED_COUNT * 2;
+    run->peak_live = t.peak_live;
+    free(order);
+    free(sizes);
+    free(ptrs);
+}
+
+/* Stack churn: push up to LIFO_DEPTH, pop LIFO_POP in reverse, repeat. Live
+ * memory stays small; allocators that can't reuse LIFO frees keep growing. */
+static void
+bench_lifo(BenchRun *run)
+{
+    void *ptrs[LIFO_DEPTH];
+    size_t sizes[LIFO_DEPTH];
+    BenchThread t = { .run = run };
+    uint64_t seed = 0xABCDEFULL;
+    size_t ops = 0;
+    int depth = 0;
+
+    while (ops < LIFO_OPS) {
+        sizes[depth] = 16 + (size_t)(bench_rand(&seed) % (LIFO_MAX - 16 + 1));
+        ptrs[depth] = bench_alloc(&t, sizes[depth]);
+        ++depth;
+        ++ops;
+
+        if (depth == LIFO_DEPTH) {
+            while (depth > LIFO_DEPTH - LIFO_POP) {
+                --depth;
+                bench_free(&t, ptrs[depth], sizes[depth]);
+                ++ops;
+            }
+        }
+    }
+    while (depth > 0) {
+        --depth;
+        bench_free(&t, ptrs[depth], sizes[depth]);
+        ++ops;
+    }
+    bench_rss_probe(run);
+    run->a->reset();
+
+    run->ops = ops;
+    run->peak_live = t.peak_live;
+}
+
+/* Single producer allocates, single consumer frees, through an SPSC ring. */
+typedef struct BenchRing {
+    void *slots[PC_RING];
+    size_t head; /* written by producer */
+    size_t tail; /* written by consumer */
+} BenchRing;
+
+typedef struct BenchPcCtx {
+    BenchThread thread;
+    BenchRing *ring;
+} BenchPcCtx;
+
+static void *
+bench_producer(void *arg)
+{
+    BenchPcCtx *ctx = arg;
+    BenchRing *ring = ctx->ring;
+    size_t i;
+
+    for (i = 0; i < PC_COUNT; ++i) {
+        void *p = bench_alloc(&ctx->thread, PC_SIZE);
+        while (i - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= PC_RING) sched_yield();
+        ring->slots[i % PC_RING] = p;
+        __atomic_store_n(&ring->head, i + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void *
+bench_consumer(void *arg)
+{
+    BenchPcCtx *ctx = arg;
+    BenchRing *ring = ctx->ring;
+    size_t i;
+
+    for (i = 0; i < PC_COUNT; ++i) {
+        while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == i) sched_yield();
+        bench_free(&ctx->thread, ring->slots[i % PC_RING], PC_SIZE);
+        __atomic_store_n(&ring->tail, i + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void
+bench_prodcons(BenchRun *run)
+{
+    static BenchRing ring;
+    BenchPcCtx prod = { .thread = { .run = run }, .ring = &ring };
+    BenchPcCtx cons = { .thread = { .run = run }, .ring = &ring };
+    pthread_t tp, tc;
+
+    run->locked = !run->a->thread_safe;
+    pthread_create(&tc, NULL, bench_consumer, &cons);
+    pthread_create(&tp, NULL, bench_producer, &prod);
+    pthread_join(tp, NULL);
+    pthread_join(tc, NULL);
+    bench_rss_probe(run);
+    run->a->reset();
+
+    run->ops = (size_t)PC_COUNT * 2;
+    run->peak_live = (size_t)PC_RING * PC_SIZE; /* at most a full ring is live */
+}
+
+static void *
+bench_mt_worker(void *arg)
+{
+    BenchThread *t = arg;
+    void *ptrs[MT_COUNT];
+    size_t sizes[MT_COUNT];
+    uint64_t seed = 0x5EEDULL + (uint64_t)(uintptr_t)t;
+    int r, i;
+
+    for (i = 0; i < MT_COUNT; ++i) {
+        sizes[i] = MT_MIN + (size_t)(bench_rand(&seed) % (MT_MAX - MT_MIN + 1));
+    }
+    for (r = 0; r < MT_ROUNDS; ++r) {
+        for (i = 0; i < MT_COUNT; ++i) ptrs[i] = bench_alloc(t, sizes[i]);
+        for (i = 0; i < MT_COUNT; ++i) bench_free(t, ptrs[i], sizes[i]);
+    }
+    return NULL;
+}
+
+static void
+bench_threads(BenchRun *run)
+{
+    pthread_t threads[BENCH_THREADS];
+    BenchThread self[BENCH_THREADS];
+    int i;
+
+    run->locked = !run->a->thread_safe;
+    for (i = 0; i < BENCH_THREADS; ++i) {
+        self[i] = (BenchThread){ .run = run };
+        pthread_create(&threads[i], NULL, bench_mt_worker, &self[i]);
+    }
+    run->peak_live = 0;
+    for (i = 0; i < BENCH_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+        run->peak_live += self[i].peak_live;
+    }
+    bench_rss_probe(run);
+    run->a->reset();
+
+    run->ops = (size_t)BENCH_THREADS * MT_ROUNDS * MT_COUNT * 2;
+}
+
+static const BenchWorkload bench_workloads[] = {
+    { "small",    "200k x 32B, alloc all then free all",             SMALL_SIZE, bench_small },
+    { "mixed",    "50k x 16B..2KB, freed in random order",           MIXED_MAX,  bench_mixed },
+    { "lifo",     "stack churn, depth 64, 16B..256B",                LIFO_MAX,   bench_lifo },
+    { "prodcons", "one thread allocates 64B, another frees",         PC_SIZE,    bench_prodcons },
+    { "threads",  "4 threads x 1k allocs 16B..128B, shared instance", MT_MAX,     bench_threads },
+};
+
+/* ==== driver */
+
+static int
+bench_run_child(const BenchWorkload *w, const BenchAllocator *a)
+{
+    BenchRun run = { .a = a };
+    double t0, elapsed;
+    double mb, overhead, p50;
+    size_t n;
+
+    run.samples = malloc(BENCH_MAX_SAMPLES * sizeof(*run.samples));
+    if (!run.samples || !a->init(w->max_size)) {
+        fprintf(stderr, "%s: init failed\n", a->name);
+        return 1;
+    }
+    memset(run.samples, 0, BENCH_MAX_SAMPLES * sizeof(*run.samples));
+    pthread_mutex_init(&run.lock, NULL);
+    run.timer_ns = bench_timer_overhead_ns();
+    run.rss_base_kb = bench_rss_kb();
+    run.rss_peak_kb = run.rss_base_kb;
+
+    t0 = bench_now_ns();
+    w->run(&run);
+    elapsed = bench_now_ns() - t0;
+
+    n = TL_MIN(run.samples_count, (size_t)BENCH_MAX_SAMPLES);
+    p50 = bench_percentile(run.samples, n, 0.50, 0);
+    mb = (double)(run.rss_peak_kb - run.rss_base_kb) / 1024.0;
+    overhead = run.peak_live ? (mb * (double)BENCH_MB) / (double)run.peak_live : 0.0;
+
+    printf("  %-14s %8.2f %8.1f %8.1f %8.1f %10.1f %8.1f %9.2f\n",
+           a->name, elapsed / (double)run.ops,
+           p50,
+           bench_percentile(run.samples, n, 0.99, 1),
+           bench_percentile(run.samples, n, 0.999, 1),
+           bench_percentile(run.samples, n, 1.0, 1),
+           mb, overhead);
+
+    a->destroy();
+    pthread_mutex_destroy(&run.lock);
+    free(run.samples);
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t wi, ai;
+    int status = 0;
+    int ran = 0;
+
+    for (wi = 0; wi < TL_COUNT_OF(bench_workloads); ++wi) {
+        const BenchWorkload *w = &bench_workloads[wi];
+
+        if (argc > 1 && strcmp(argv[1], w->name) != 0) continue;
+        ran = 1;
+
+        printf("== %s: %s\n", w->name, w->desc);
+        printf("  %-14s %8s %8s %8s %8s %10s %8s %9s\n",
+               "allocator", "ns/op", "p50", "p99", "p99.9", "max", "rss MB", "overhead");
+        fflush(stdout);
+
+        for (ai = 0; ai < TL_COUNT_OF(bench_allocators); ++ai) {
+            int child_status = 0;
+            pid_t pid = fork();
+
+            if (pid == 0) {
+                int rc = bench_run_child(w, &bench_allocators[ai]);
+                fflush(stdout);
+                _exit(rc);
+            }
+            if (pid < 0 || waitpid(pid, &child_status, 0) < 0
+             || !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0) {
+                fprintf(stderr, "  %-14s failed\n", bench_allocators[ai].name);
+                status = 1;
+            }
+        }
+    }
+
+    if (!ran) {
+        fprintf(stderr, "unknown workload '%s'\n", argv[1]);
+        return 1;
+    }
+
+    return status;
+}
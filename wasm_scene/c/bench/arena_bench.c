@@ -0,0 +1,195 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * arena_bench.c
+ *   TL_Arena allocation cost as the chunk count grows.
+ *
+ *   Usage:
+ *     target/bench/arena_bench
+ *
+ *   Growth is disabled (4KB chunks, ~1KB requests) so the arena reaches
+ *   CHUNK_TARGET chunks; ns/alloc is printed per window of CHUNK_WINDOW new
+ *   chunks and should stay flat. The second pass runs after tl_arena_reset()
+ *   and is served entirely from recycled chunks.
+ *
+ *   The last section grows arena-backed tl_arr arrays one push at a time;
+ *   growth of the newest allocation happens in place, so arena bytes stay
+ *   close to the arrays' own size.
+ *
+ *   temp scopes: TL_TEMP_SCOPE on the thread's scratch arenas against a
+ *   fresh TL_Arena created and destroyed per scope.
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    CHUNK_CAP    = 4096,
+    CHUNK_TARGET = 120000,
+    CHUNK_WINDOW = 20000,
+    ALLOC_SIZE   = 1000,
+};
+
+static size_t
+bench_count_chunks(const TL_ArenaChunk *chunk)
+{
+    size_t n = 0;
+    for (; chunk; chunk = chunk->next) ++n;
+    return n;
+}
+
+static void
+bench_report_window(size_t from, size_t to, double ns, size_t allocs)
+{
+    char range[32];
+
+    snprintf(range, sizeof(range), "%zuk..%zuk", from / 1000, to / 1000);
+    printf("  %-16s %12.2f\n", range, ns / (double)allocs);
+}
+
+static void
+bench_fill(TL_Arena *arena, const char *pass)
+{
+    size_t chunks = bench_count_chunks(arena->chunks);
+    size_t window_start = chunks;
+    size_t allocs = 0;
+    double t0;
+
+    printf("%s\n", pass);
+    printf("  %-16s %12s\n", "chunks", "ns/alloc");
+
+    t0 = bench_now_ns();
+    while (chunks < CHUNK_TARGET) {
+        TL_ArenaChunk *before = arena->current;
+        void *p = tl_arena_alloc(arena, ALLOC_SIZE);
+
+        if (!p) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        bench_sink += (uintptr_t)p;
+        ++allocs;
+        if (arena->current != before) ++chunks;
+
+        if (chunks - window_start == CHUNK_WINDOW) {
+            bench_report_window(window_start, chunks, bench_now_ns() - t0, allocs);
+            window_start = chunks;
+            allocs = 0;
+            t0 = bench_now_ns();
+        }
+    }
+    if (allocs) bench_report_window(window_start, chunks, bench_now_ns() - t0, allocs);
+}
+
+static size_t
+bench_arena_used(const TL_Arena *arena)
+{
+    const TL_ArenaChunk *chunk;
+    size_t used = 0;
+
+    for (chunk = arena->chunks; chunk; chunk = chunk->next) used += chunk->used;
+    return used;
+}
+
+static void
+bench_arr_growth(void)
+{
+    enum { ARR_COUNT = 64, ARR_LEN = 16384 };
+    TL_Arena arena = {0};
+    TL_Allocator a = tl_get_allocator_arena(&arena);
+    int *arr;
+    size_t pushes = 0;
+    double t0;
+    int i, j;
+
+    printf("arena-backed tl_arr growth (%d arrays x %d ints)\n", ARR_COUNT, ARR_LEN);
+    t0 = bench_now_ns();
+    for (i = 0; i < ARR_COUNT; ++i) {
+        arr = NULL;
+        tl_arr_init(arr, &a);
+        for (j = 0; j < ARR_LEN; ++j) tl_arr_push(arr, j);
+        bench_sink += (uintptr_t)arr[ARR_LEN - 1];
+        pushes += ARR_LEN;
+    }
+    printf("  %.2f ns/push, arena %.1f MB for %.1f MB of elements\n",
+           (bench_now_ns() - t0) / (double)pushes,
+           (double)bench_arena_used(&arena) / (double)BENCH_MB,
+           (double)(pushes * sizeof(int)) / (double)BENCH_MB);
+    tl_arena_destroy(&arena);
+}
+
+static void
+bench_temp_scope_work(TL_Arena *arena)
+{
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        byte_t *p = tl_arena_alloc(arena, 1024);
+        p[0] = (byte_t)i;
+        bench_sink += (uintptr_t)p[0];
+    }
+}
+
+static void
+bench_temp_scopes(void)
+{
+    enum { SCOPES = 200000 };
+    double t0, t_fresh, t_scratch;
+    int i;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < SCOPES; ++i) {
+        TL_Arena arena = {0};
+        bench_temp_scope_work(&arena);
+        tl_arena_destroy(&arena);
+    }
+    t_fresh = (bench_now_ns() - t0) / SCOPES;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < SCOPES; ++i) {
+        TL_TEMP_SCOPE(tmp) {
+            bench_temp_scope_work(tmp);
+        }
+    }
+    t_scratch = (bench_now_ns() - t0) / SCOPES;
+    tl_scratch_release();
+
+    printf("temp scopes (16 x 1KB each)\n  fresh arena %.1f ns/scope, scratch %.1f ns/scope\n",
+           t_fresh, t_scratch);
+}
+
+int
+main(void)
+{
+    TL_Arena arena;
+    TL_Arena grow = {0};
+    long rss0;
+    size_t i;
+    double t0;
+
+    tl_arena_init(&arena, CHUNK_CAP, CHUNK_CAP);
+
+    rss0 = bench_rss_kb();
+    bench_fill(&arena, "fresh chunks (malloc per chunk)");
+    printf("  rss %.1f MB\n", (double)(bench_rss_kb() - rss0) / 1024.0);
+
+    tl_arena_reset(&arena);
+    bench_fill(&arena, "after reset (recycled chunks)");
+    printf("  free list %zu chunks\n", bench_count_chunks(arena.free_chunks));
+    tl_arena_destroy(&arena);
+
+    /* the same number of requests with default geometric growth */
+    t0 = bench_now_ns();
+    for (i = 0; i < (size_t)CHUNK_TARGET * (CHUNK_CAP / ALLOC_SIZE); ++i) {
+        bench_sink += (uintptr_t)tl_arena_alloc(&grow, ALLOC_SIZE);
+    }
+    printf("default growth\n  %zu chunks, %.2f ns/alloc\n",
+           bench_count_chunks(grow.chunks),
+           (bench_now_ns() - t0) / (double)i);
+    tl_arena_destroy(&grow);
+
+    bench_arr_growth();
+    bench_temp_scopes();
+    return 0;
+}
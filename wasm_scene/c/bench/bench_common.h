@@ -0,0 +1,104 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * bench_common.h
+ *   Timing, percentile and RSS helpers shared by the benchmarks in bench/.
+ *
+ *   Built and run by `./build bench`; each benchmark is its own executable.
+ */
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tinylib/c_ext.h"
+
+#define BENCH_KB ((size_t)1 << 10)
+#define BENCH_MB ((size_t)1 << 20)
+
+/* Keeps the optimiser from deleting work nobody reads. */
+static volatile uintptr_t bench_sink;
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+double
+bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Cost of one bench_now_ns() pair, subtracted from per-op samples. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+double
+bench_timer_overhead_ns(void)
+{
+    double best = 1e9;
+    int i;
+
+    for (i = 0; i < 1000; ++i) {
+        double t0 = bench_now_ns();
+        double t1 = bench_now_ns();
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+
+/* Resident set size in KB, from /proc/self/statm. 0 when unavailable. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+long
+bench_rss_kb(void)
+{
+    long pages = 0;
+    long resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+
+    if (!f) return 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static inline
+int
+bench__cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Sorts `samples` in place and returns the q-quantile, q in [0, 1]. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+double
+bench_percentile(double *samples, size_t count, double q, int sorted)
+{
+    size_t idx;
+
+    if (count == 0) return 0.0;
+    if (!sorted) qsort(samples, count, sizeof(samples[0]), bench__cmp_double);
+    idx = (size_t)(q * (double)(count - 1) + 0.5);
+    return samples[idx];
+}
+
+/* xorshift64*, deterministic across runs so every allocator sees the same sizes. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+uint64_t
+bench_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+#endif /* BENCH_COMMON_H */
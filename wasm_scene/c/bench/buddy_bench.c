@@ -0,0 +1,143 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * buddy_bench.c
+ *   TL_BuddyAllocator vs malloc for large I/O-style buffers.
+ *
+ *   Usage:
+ *     target/bench/buddy_bench
+ *
+ *   buffers: LIVE buffers of 64KB..4MB (log-uniform); each op frees one and
+ *            allocates a replacement, then writes one byte per page of it,
+ *            as filling a read buffer would.
+ *   growth:  a read buffer starting at 64KB doubles by realloc up to 64MB,
+ *            as when reading a file of unknown size; counts moves.
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    LIVE        = 32,
+    BUFFER_OPS  = 20000,
+    GROW_ROUNDS = 50,
+};
+
+#define BUDDY_POOL_BYTES ((size_t)1 << 30)
+#define BUDDY_MIN_BLOCK  ((size_t)64 << 10)
+#define BUDDY_MAX_BLOCK  ((size_t)64 << 20)
+#define PAGE_BYTES       4096
+
+static TL_BuddyAllocator buddy;
+static TL_Allocator std_alloc;
+static TL_Allocator buddy_alloc;
+
+static void
+bench_touch(byte_t *p, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i += PAGE_BYTES) p[i] = (byte_t)i;
+}
+
+static void
+bench_buffers(const char *name, TL_Allocator *a)
+{
+    static double samples[BUFFER_OPS];
+    void *bufs[LIVE];
+    size_t sizes[LIVE];
+    uint64_t seed = 77;
+    double sum = 0.0;
+    double p50;
+    long rss0 = bench_rss_kb();
+    long rss_peak = rss0;
+    size_t i;
+
+    for (i = 0; i < LIVE; ++i) {
+        sizes[i] = BUDDY_MIN_BLOCK << (bench_rand(&seed) % 7);
+        bufs[i] = tl_allocator_alloc(a, sizes[i]);
+        bench_touch(bufs[i], sizes[i]);
+    }
+
+    for (i = 0; i < BUFFER_OPS; ++i) {
+        size_t k = (size_t)(bench_rand(&seed) % LIVE);
+        size_t size = (BUDDY_MIN_BLOCK << (bench_rand(&seed) % 7)) - (size_t)(bench_rand(&seed) % 4096);
+        double t0 = bench_now_ns();
+
+        tl_allocator_free(a, bufs[k], sizes[k]);
+        bufs[k] = tl_allocator_alloc(a, size);
+        if (!bufs[k]) {
+            fprintf(stderr, "%s: out of memory\n", name);
+            exit(1);
+        }
+        bench_touch(bufs[k], size);
+        samples[i] = bench_now_ns() - t0;
+        sum += samples[i];
+        sizes[k] = size;
+        if (i % 1000 == 0) rss_peak = TL_MAX(rss_peak, bench_rss_kb());
+    }
+
+    for (i = 0; i < LIVE; ++i) tl_allocator_free(a, bufs[i], sizes[i]);
+
+    p50 = bench_percentile(samples, BUFFER_OPS, 0.50, 0);
+    printf("  %-8s %10.0f %10.0f %10.0f %10.0f %8.1f\n", name,
+           sum / BUFFER_OPS, p50,
+           bench_percentile(samples, BUFFER_OPS, 0.99, 1),
+           bench_percentile(samples, BUFFER_OPS, 1.0, 1),
+           (double)(rss_peak - rss0) / 1024.0);
+}
+
+static void
+bench_growth(const char *name, TL_Allocator *a)
+{
+    size_t moves = 0;
+    double t0 = bench_now_ns();
+    int r;
+
+    for (r = 0; r < GROW_ROUNDS; ++r) {
+        size_t size = BUDDY_MIN_BLOCK;
+        byte_t *buf = tl_allocator_alloc(a, size);
+
+        buf[0] = 1;
+        while (size < BUDDY_MAX_BLOCK) {
+            byte_t *next = tl_allocator_realloc(a, buf, size, size * 2);
+
+            if (!next) {
+                fprintf(stderr, "%s: out of memory\n", name);
+                exit(1);
+            }
+            moves += next != buf;
+            buf = next;
+            buf[size] = 1;
+            size *= 2;
+        }
+        tl_allocator_free(a, buf, size);
+    }
+    printf("  %-8s %10.1f us/round %8.1f moves/round\n", name,
+           (bench_now_ns() - t0) / GROW_ROUNDS / 1000.0, (double)moves / GROW_ROUNDS);
+}
+
+int
+main(void)
+{
+    if (!tl_buddy_init_mapped(&buddy, BUDDY_POOL_BYTES, BUDDY_MIN_BLOCK, BUDDY_MAX_BLOCK)) {
+        fprintf(stderr, "buddy: cannot map %zu MB\n", BUDDY_POOL_BYTES / BENCH_MB);
+        return 1;
+    }
+    std_alloc = tl_default_allocator;
+    buddy_alloc = tl_get_allocator_buddy(&buddy);
+
+    printf("== buffers: %d live, 64KB..4MB, %d replacements (ns/op incl. page touches)\n",
+           LIVE, BUFFER_OPS);
+    printf("  %-8s %10s %10s %10s %10s %8s\n", "", "mean", "p50", "p99", "max", "rss MB");
+    bench_buffers("malloc", &std_alloc);
+    bench_buffers("buddy", &buddy_alloc);
+
+    printf("== growth: 64KB -> 64MB by doubling realloc\n");
+    bench_growth("malloc", &std_alloc);
+    bench_growth("buddy", &buddy_alloc);
+
+    tl_buddy_destroy(&buddy);
+    return 0;
+}
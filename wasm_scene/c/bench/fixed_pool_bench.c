@@ -0,0 +1,131 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * fixed_pool_bench.c
+ *   TL_FixedPool RSS across a load spike, and alloc/free cost.
+ *
+ *   Usage:
+ *     target/bench/fixed_pool_bench
+ *
+ *   spike:  a long-lived working set, then a burst of short-lived blocks
+ *           that are all freed again; tl_fixed_pool_trim() should bring RSS
+ *           back to the working set.
+ *   mixed:  the burst keeps every 64th block alive, so no chunk empties;
+ *           refilling afterwards should reuse those chunks, not add new ones.
+ *   churn:  random alloc/free over a steady live set (ns/op).
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    BLOCK_SIZE     = 64,
+    BLOCKS_PER     = 1024,
+    BASE_COUNT     = 20000,
+    SPIKE_COUNT    = 1000000,
+    SURVIVOR_EVERY = 64,
+    CHURN_LIVE     = 100000,
+    CHURN_OPS      = 4000000,
+};
+
+static void *base[BASE_COUNT];
+static void *spike[SPIKE_COUNT];
+
+static void *
+bench_alloc(TL_FixedPool *pool)
+{
+    void *p = tl_fixed_pool_alloc(pool, BLOCK_SIZE, TL_MEM_ALIGN);
+
+    if (!p) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    memset(p, 0xab, BLOCK_SIZE);
+    return p;
+}
+
+static void
+bench_report(const char *phase, const TL_FixedPool *pool, long rss0)
+{
+    printf("  %-24s %10zu %10.1f\n", phase, pool->chunk_count,
+           (double)(bench_rss_kb() - rss0) / 1024.0);
+}
+
+static void
+bench_spike(b32_t keep_survivors)
+{
+    TL_FixedPool pool;
+    long rss0;
+    size_t chunks;
+    size_t i;
+
+    /* keep the pointer arrays themselves out of the numbers */
+    memset(base, 0, sizeof(base));
+    memset(spike, 0, sizeof(spike));
+    rss0 = bench_rss_kb();
+
+    tl_fixed_pool_init(&pool, BLOCK_SIZE, TL_MEM_ALIGN, BLOCKS_PER);
+    printf("%s\n", keep_survivors ? "mixed (1/64 of the burst survives)" : "spike");
+    printf("  %-24s %10s %10s\n", "phase", "chunks", "rss MB");
+
+    for (i = 0; i < BASE_COUNT; ++i) base[i] = bench_alloc(&pool);
+    bench_report("working set", &pool, rss0);
+
+    for (i = 0; i < SPIKE_COUNT; ++i) spike[i] = bench_alloc(&pool);
+    bench_report("burst", &pool, rss0);
+
+    for (i = 0; i < SPIKE_COUNT; ++i) {
+        if (keep_survivors && i % SURVIVOR_EVERY == 0) continue;
+        tl_fixed_pool_free(&pool, spike[i]);
+    }
+    bench_report("burst freed", &pool, rss0);
+
+    printf("  %-24s %10zu\n", "trim released", tl_fixed_pool_trim(&pool));
+    bench_report("after trim", &pool, rss0);
+
+    /* refill half the burst: the fullest partial chunks are used first */
+    chunks = pool.chunk_count;
+    for (i = 0; i < SPIKE_COUNT / 2; ++i) {
+        if (keep_survivors && i % SURVIVOR_EVERY == 0) continue;
+        spike[i] = bench_alloc(&pool);
+    }
+    bench_report("refill half", &pool, rss0);
+    printf("  %-24s %10zu\n", "new chunks on refill", pool.chunk_count - chunks);
+
+    tl_fixed_pool_destroy(&pool);
+}
+
+static void
+bench_churn(void)
+{
+    TL_FixedPool pool;
+    uint64_t seed = 1234;
+    double t0;
+    size_t i;
+
+    tl_fixed_pool_init(&pool, BLOCK_SIZE, TL_MEM_ALIGN, BLOCKS_PER);
+    for (i = 0; i < CHURN_LIVE; ++i) spike[i] = bench_alloc(&pool);
+
+    t0 = bench_now_ns();
+    for (i = 0; i < CHURN_OPS; ++i) {
+        size_t k = (size_t)(bench_rand(&seed) % CHURN_LIVE);
+
+        tl_fixed_pool_free(&pool, spike[k]);
+        spike[k] = tl_fixed_pool_alloc(&pool, BLOCK_SIZE, TL_MEM_ALIGN);
+        *(volatile byte_t *)spike[k] = 1;
+    }
+    printf("churn\n  %zu live, %.2f ns/op, %zu chunks\n", (size_t)CHURN_LIVE,
+           (bench_now_ns() - t0) / ((double)CHURN_OPS * 2), pool.chunk_count);
+
+    tl_fixed_pool_destroy(&pool);
+}
+
+int
+main(void)
+{
+    bench_spike(0);
+    bench_spike(1);
+    bench_churn();
+    return 0;
+}
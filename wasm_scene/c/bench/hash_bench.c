@@ -0,0 +1,156 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * hash_bench.c
+ *   tl_hash_bytes (wyhash-style) vs byte-at-a-time FNV-1a: raw throughput,
+ *   and TL_Map lookup cost with each as the key hash.
+ *
+ *   Usage:
+ *     target/bench/hash_bench
+ *
+ *   throughput: hashes a buffer of each length repeatedly (GB/s, ns/hash).
+ *   lookup:     MAP_KEYS keys of a given kind in a map, then LOOKUPS random
+ *               hits; u32/u64 keys use the word fast paths, string keys are
+ *               TL_StrViews of 8..64 bytes.
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    HASH_BYTES = 1 << 24,
+    MAP_KEYS   = 1 << 16,
+    LOOKUPS    = 4000000,
+    STR_MAX    = 64,
+};
+
+static byte_t buf[HASH_BYTES];
+static char strs[MAP_KEYS][STR_MAX];
+static TL_StrView views[MAP_KEYS];
+static u64_t words[MAP_KEYS];
+static u32_t halves[MAP_KEYS];
+
+static u64_t bench_wy(const void *p, size_t n) { return tl_hash_wy(p, n, TL_HASH_SEED); }
+
+static u64_t
+bench_fnv_strview_key(const void *key, size_t key_size)
+{
+    const TL_StrView *sv = (const TL_StrView *)key;
+    (void)key_size;
+    return tl_hash_fnv1a(sv->data + sv->beg, sv->end - sv->beg);
+}
+
+static void
+bench_throughput(size_t len)
+{
+    static const struct {
+        const char *name;
+        u64_t (*hash)(const void *p, size_t n);
+    } hashes[] = {
+        { "fnv1a", tl_hash_fnv1a },
+        { "wy",    bench_wy },
+    };
+    size_t iters = TL_MAX((size_t)HASH_BYTES / len, (size_t)1000000);
+    size_t h, i;
+
+    printf("  %6zu", len);
+    for (h = 0; h < TL_COUNT_OF(hashes); ++h) {
+        u64_t acc = 0;
+        double t0 = bench_now_ns();
+        double dt;
+
+        /* slide the window so each call sees different bytes */
+        for (i = 0; i < iters; ++i) acc += hashes[h].hash(buf + ((i * 8) & (HASH_BYTES / 2 - 1)), len);
+        dt = bench_now_ns() - t0;
+        bench_sink += (uintptr_t)acc;
+        printf(" %10.2f %8.2f", (double)len * (double)iters / dt, dt / (double)iters);
+    }
+    printf("\n");
+}
+
+/* keys are MAP_KEYS words of key_size bytes at keys */
+static double
+bench_lookup_words(const void *keys, size_t key_size, TL_MapHashFn hash)
+{
+    const byte_t *k = (const byte_t *)keys;
+    TL_Map map;
+    uint64_t seed = 3;
+    u64_t acc = 0;
+    double t0;
+    size_t i;
+
+    tl_map_init_impl(&map, key_size, key_size, sizeof(u64_t), TL_ALIGNOF(u64_t), NULL, hash, tl_map_eq_bytes_key);
+    for (i = 0; i < MAP_KEYS; ++i) {
+        tl_map_put_impl(&map, k + i * key_size, key_size, key_size, &words[i], sizeof(u64_t), TL_ALIGNOF(u64_t));
+    }
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) {
+        const void *key = k + (size_t)(bench_rand(&seed) % MAP_KEYS) * key_size;
+        acc += *(const u64_t *)tl_map_get_const_impl(&map, key, key_size, key_size);
+    }
+    bench_sink += (uintptr_t)acc;
+    t0 = (bench_now_ns() - t0) / LOOKUPS;
+    tl_map_free(map);
+    return t0;
+}
+
+static double
+bench_lookup_strs(TL_MapHashFn hash)
+{
+    TL_Map map;
+    uint64_t seed = 3;
+    size_t acc = 0;
+    double t0;
+    size_t i;
+
+    tl_map_init_ex(map, TL_StrView, size_t, NULL, hash, tl_map_eq_strview_key);
+    for (i = 0; i < MAP_KEYS; ++i) tl_map_put(map, views[i], i);
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += *tl_map_get_const_strview(map, views[bench_rand(&seed) % MAP_KEYS], size_t);
+    bench_sink += acc;
+    t0 = (bench_now_ns() - t0) / LOOKUPS;
+    tl_map_free(map);
+    return t0;
+}
+
+int
+main(void)
+{
+    static const size_t lens[] = { 4, 8, 16, 32, 64, 256, 4096 };
+    uint64_t seed = 17;
+    size_t i, j;
+
+    for (i = 0; i < HASH_BYTES; ++i) buf[i] = (byte_t)bench_rand(&seed);
+    for (i = 0; i < MAP_KEYS; ++i) {
+        size_t len = 8 + (size_t)(bench_rand(&seed) % (STR_MAX - 8));
+
+        /* shared prefix, as identifiers and paths tend to have */
+        memcpy(strs[i], "scene/node/", 11);
+        for (j = 11; j < len; ++j) strs[i][j] = (char)('a' + bench_rand(&seed) % 26);
+        /* make every key unique */
+        memcpy(strs[i] + len - 4, &i, 4);
+        views[i] = (TL_StrView){ .data = strs[i], .beg = 0, .end = len };
+        words[i] = bench_rand(&seed);
+        halves[i] = (u32_t)words[i];
+    }
+
+    printf("== throughput (GB/s, ns/hash)\n");
+    printf("  %6s %19s %19s\n", "bytes", "fnv1a", "wy");
+    for (i = 0; i < TL_COUNT_OF(lens); ++i) bench_throughput(lens[i]);
+
+    printf("== lookup: %d keys, %d random hits (ns/lookup)\n", MAP_KEYS, LOOKUPS);
+    printf("  %-8s %10s %10s\n", "key", "fnv1a", "default");
+    printf("  %-8s %10.2f %10.2f\n", "u32",
+           bench_lookup_words(halves, sizeof(u32_t), tl_map_hash_fnv1a_key),
+           bench_lookup_words(halves, sizeof(u32_t), tl_map_hash_bytes_key));
+    printf("  %-8s %10.2f %10.2f\n", "u64",
+           bench_lookup_words(words, sizeof(u64_t), tl_map_hash_fnv1a_key),
+           bench_lookup_words(words, sizeof(u64_t), tl_map_hash_bytes_key));
+    printf("  %-8s %10.2f %10.2f\n", "strview",
+           bench_lookup_strs(bench_fnv_strview_key),
+           bench_lookup_strs(tl_map_hash_strview_key));
+    return 0;
+}
@@ -0,0 +1,495 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * map_bench.c
+ *   TL_Map insert and lookup cost from cache-resident to DRAM-bound sizes,
+ *   and the same against maps from TL_DEFINE_MAP (typed).
+ *
+ *   Usage:
+ *     target/bench/map_bench [max_keys]
+ *
+ *   u64:     random 64-bit keys, 64-bit values.
+ *   strview: 16..48-byte string keys sharing a prefix, so equal hash bits
+ *            still cost a memcmp that reaches the key bytes.
+ *
+ *   churn:   a session table: each op removes the oldest key and inserts a
+ *            new one, so the live count stays put while every slot turns
+ *            over many times. Reports per-op latency and how far entries
+ *            sit from their home slot afterwards.
+ *   grow:    inserts into an empty map, rehashing all at once vs
+ *            incrementally (REHASH_STEP old slots per op); the stall of a
+ *            full rehash shows up in the max.
+ *
+ *   Sizes go from 64K keys up to max_keys (default 8M) by 8x. hit looks up
+ *   present keys in random order, miss looks up keys that were never
+ *   inserted.
+ *
+ *   Before timing anything, random put/remove/get sequences are checked
+ *   against a plain array, with all-at-once and incremental rehashing, and
+ *   steps 1 and 2 must finish each migration before the next grow. Typed
+ *   maps get the same check, one of them with a hash that puts every key in
+ *   8 home slots. A mismatch prints the op and exits 1.
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    LOOKUPS   = 2000000,
+    CHURN_OPS = 4000000,
+    CHECK_KEYS = 4096,
+    CHECK_OPS  = 400000,
+    REHASH_STEP = 64,
+    STR_BYTES = 48,
+    STR_KEYS  = 1 << 20,  /* string tables stop here; the key text gets big */
+};
+
+/* 8 home slots for every key: runs far longer than TL_MAP_DIST_SAT, so the
+ * check also covers distances recomputed from the hash */
+#define BENCH_HASH_CLUSTER(key) tl_hash_u64(*(key) % 8)
+
+TL_DEFINE_MAP(BenchU64Map, u64_t, u64_t, TL_MAP_HASH_U64, TL_MAP_EQ_SCALAR)
+TL_DEFINE_MAP(BenchStrMap, TL_StrView, size_t, TL_MAP_HASH_STRVIEW, TL_MAP_EQ_STRVIEW)
+TL_DEFINE_MAP(BenchClusterMap, u64_t, u64_t, BENCH_HASH_CLUSTER, TL_MAP_EQ_SCALAR)
+
+typedef struct MapBenchRow {
+    double insert;
+    double hit;
+    double miss;
+} MapBenchRow;
+
+static u64_t
+bench_key(size_t i)
+{
+    /* odd multiplier: a bijection, so keys are distinct and misses are
+     * the same function on indices past n */
+    return (u64_t)(i + 1) * UINT64_C(0x9E3779B97F4A7C15);
+}
+
+/* Random ops on keys [0, CHECK_KEYS), mirrored in ref/live; every map
+ * answer is compared against the array. */
+static b32_t
+bench_check(size_t step, uint64_t seed)
+{
+    static u64_t ref[CHECK_KEYS];
+    static b32_t live[CHECK_KEYS];
+    TL_Map map;
+    size_t count = 0;
+    size_t op, k;
+    b32_t ok = 1;
+
+    memset(live, 0, sizeof(live));
+    tl_map_init_bytewise(map, u64_t, u64_t, NULL);
+    tl_map_set_incremental(map, step);
+    for (op = 0; op < CHECK_OPS && ok; ++op) {
+        u64_t r = bench_rand(&seed);
+        size_t key_i = (size_t)(r % CHECK_KEYS);
+        u64_t key = bench_key(key_i);
+        const u64_t *got;
+
+        /* drain now and then, so the map also goes empty mid-migration */
+        if (op % 20000 == 19999) {
+            for (k = CHECK_KEYS; k-- > 0;) {
+                if (live[k] && !tl_map_remove(map, bench_key(k))) ok = 0;
+                live[k] = 0;
+            }
+            count = 0;
+        }
+
+        switch ((r >> 32) % 8) {
+        case 0: case 1: case 2:
+            if (!tl_map_put(map, key, r)) ok = 0;
+            count += !live[key_i];
+            live[key_i] = 1;
+            ref[key_i] = r;
+            break;
+        case 3: case 4: case 5:
+            if (tl_map_remove(map, key) != live[key_i]) ok = 0;
+            count -= live[key_i];
+            live[key_i] = 0;
+            break;
+        case 6:
+            got = tl_map_get_mut(map, key, u64_t);
+            if ((got != NULL) != live[key_i] || (got && *got != ref[key_i])) ok = 0;
+            break;
+        default:
+            if ((r >> 40) % 64 == 0) {
+                if (!tl_map_reserve(map, count + (size_t)(r >> 48) % CHECK_KEYS)) ok = 0;
+            } else {
+                (void)tl_map_rehash_step(map, (size_t)(r >> 48) % 16);
+            }
+            break;
+        }
+        if (tl_map_len(map) != count) ok = 0;
+        if (!ok) fprintf(stderr, "map check: step %zu, op %zu, key %zu\n", step, op, key_i);
+    }
+    for (k = 0; k < CHECK_KEYS && ok; ++k) {
+        const u64_t *got = tl_map_get_const(map, bench_key(k), u64_t);
+
+        if ((got != NULL) != live[k] || (got && *got != ref[k])) {
+            fprintf(stderr, "map check: step %zu, final key %zu\n", step, k);
+            ok = 0;
+        }
+    }
+    tl_map_free(map);
+    return ok;
+}
+
+/* bench_check for a TL_DEFINE_MAP type, on keys [0, keys) and with every
+ * op the type has. want_sat also requires some entry to have been stored
+ * with a saturated distance. */
+#define BENCH_DEFINE_TYPED_CHECK(Name) \
+    static b32_t \
+    Name##_check(size_t keys, size_t ops, uint64_t seed, b32_t want_sat) \
+    { \
+        static u64_t ref[CHECK_KEYS]; \
+        static b32_t live[CHECK_KEYS]; \
+        Name map; \
+        size_t count = 0; \
+        size_t op, k; \
+        b32_t saw_sat = 0; \
+        b32_t ok = 1; \
+        \
+        memset(live, 0, sizeof(live)); \
+        Name##_init(&map, NULL); \
+        for (op = 0; op < ops && ok; ++op) { \
+            u64_t r = bench_rand(&seed); \
+            size_t key_i = (size_t)(r % keys); \
+            u64_t key = bench_key(key_i); \
+            const u64_t *got; \
+            u64_t *mut; \
+            u64_t out; \
+            \
+            if (op % 20000 == 19999) { \
+                for (k = 0; k < map.cap; ++k) { \
+                    saw_sat |= TL_MAP_IS_FULL(map.states[k]) && map.dists[k] == TL_MAP_DIST_SAT; \
+                } \
+                for (k = keys; k-- > 0;) { \
+                    if (live[k] && !Name##_remove(&map, bench_key(k))) ok = 0; \
+                    live[k] = 0; \
+                } \
+                count = 0; \
+            } \
+            \
+            switch ((r >> 32) % 8) { \
+            case 0: case 1: case 2: \
+                if (!Name##_put(&map, key, r)) ok = 0; \
+                count += !live[key_i]; \
+                live[key_i] = 1; \
+                ref[key_i] = r; \
+                break; \
+            case 3: case 4: \
+                if (Name##_remove(&map, key) != live[key_i]) ok = 0; \
+                count -= live[key_i]; \
+                live[key_i] = 0; \
+                break; \
+            case 5: \
+                mut = Name##_get_mut(&map, key); \
+                if ((mut != NULL) != live[key_i] || (mut && *mut != ref[key_i])) ok = 0; \
+                if (mut) *mut = ref[key_i] = r >> 1; \
+                break; \
+            case 6: \
+                if (Name##_try_get(&map, key, &out) != live[key_i] || (live[key_i] && out != ref[key_i])) ok = 0; \
+                got = Name##_get_const(&map, key); \
+                if ((got != NULL) != live[key_i] || Name##_contains(&map, key) != live[key_i]) ok = 0; \
+                break; \
+            default: \
+                if ((r >> 40) % 64 == 0 && !Name##_reserve(&map, count + (size_t)(r >> 48) % keys)) ok = 0; \
+                break; \
+            } \
+            if (map.len != count) ok = 0; \
+            if (!ok) fprintf(stderr, "map check: " #Name ", op %zu, key %zu\n", op, key_i); \
+        } \
+        for (k = 0; k < keys && ok; ++k) { \
+            const u64_t *got = Name##_get_const(&map, bench_key(k)); \
+            \
+            if ((got != NULL) != live[k] || (got && *got != ref[k])) { \
+                fprintf(stderr, "map check: " #Name ", final key %zu\n", k); \
+                ok = 0; \
+            } \
+        } \
+        if (ok && want_sat && !saw_sat) { \
+            fprintf(stderr, "map check: " #Name ", no saturated distance seen\n"); \
+            ok = 0; \
+        } \
+        Name##_free(&map); \
+        return ok; \
+    }
+
+BENCH_DEFINE_TYPED_CHECK(BenchU64Map)
+BENCH_DEFINE_TYPED_CHECK(BenchClusterMap)
+
+/* Drains the map while a migration is pending, then rehashes again: the
+ * rehash finishes the old migration and must not keep its freed table. */
+static b32_t
+bench_check_drain(void)
+{
+    TL_Map map;
+    b32_t ok = 1;
+    size_t i;
+
+    tl_map_init_bytewise(map, u64_t, u64_t, NULL);
+    tl_map_set_incremental(map, 1);
+    for (i = 0; i < 48; ++i) (void)tl_map_put(map, (u64_t)i, (u64_t)i);
+    /* newest keys first: the early ones are still in the old table, so the
+     * last remove empties it without a migrate step to free it */
+    for (i = 48; i-- > 0;) ok &= tl_map_remove(map, (u64_t)i);
+    ok &= tl_map_rehashing(map);
+    ok &= tl_map_reserve(map, 1000);
+    for (i = 0; i < 1000; ++i) ok &= tl_map_put(map, (u64_t)i, (u64_t)i);
+    for (i = 0; i < 1000; ++i) ok &= tl_map_contains(map, (u64_t)i);
+    ok &= tl_map_len(map) == 1000;
+    if (!ok) fprintf(stderr, "map check: drain while rehashing\n");
+    tl_map_free(map);
+    return ok;
+}
+
+/* Puts only, with a small step: each migration must be over before the put
+ * that grows the table again, or that put would have to finish it. */
+static b32_t
+bench_check_grow(size_t step)
+{
+    TL_Map map;
+    b32_t ok = 1;
+    size_t i;
+
+    tl_map_init_bytewise(map, u64_t, u64_t, NULL);
+    tl_map_set_incremental(map, step);
+    for (i = 0; i < (size_t)1 << 18 && ok; ++i) {
+        size_t cap = tl_map_cap(map);
+
+        if (tl_map_len(map) + 1 >= cap - cap / 4 && tl_map_rehashing(map)) {
+            fprintf(stderr, "map check: step %zu still migrating at grow, %zu keys\n", step, i);
+            ok = 0;
+        }
+        ok &= tl_map_put(map, bench_key(i), (u64_t)i);
+    }
+    tl_map_free(map);
+    return ok;
+}
+
+static MapBenchRow
+bench_u64(size_t n)
+{
+    MapBenchRow row;
+    TL_Map map;
+    uint64_t seed = 9;
+    u64_t acc = 0;
+    double t0;
+    size_t i;
+
+    tl_map_init_bytewise(map, u64_t, u64_t, NULL);
+    t0 = bench_now_ns();
+    for (i = 0; i < n; ++i) tl_map_put(map, bench_key(i), (u64_t)i);
+    row.insert = (bench_now_ns() - t0) / (double)n;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += *tl_map_get_const(map, bench_key(bench_rand(&seed) % n), u64_t);
+    row.hit = (bench_now_ns() - t0) / LOOKUPS;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += tl_map_contains(map, bench_key(n + bench_rand(&seed) % n));
+    row.miss = (bench_now_ns() - t0) / LOOKUPS;
+
+    bench_sink += (uintptr_t)acc;
+    tl_map_free(map);
+    return row;
+}
+
+static MapBenchRow
+bench_u64_typed(size_t n)
+{
+    MapBenchRow row;
+    BenchU64Map map;
+    uint64_t seed = 9;
+    u64_t acc = 0;
+    double t0;
+    size_t i;
+
+    BenchU64Map_init(&map, NULL);
+    t0 = bench_now_ns();
+    for (i = 0; i < n; ++i) BenchU64Map_put(&map, bench_key(i), (u64_t)i);
+    row.insert = (bench_now_ns() - t0) / (double)n;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += *BenchU64Map_get_const(&map, bench_key(bench_rand(&seed) % n));
+    row.hit = (bench_now_ns() - t0) / LOOKUPS;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += BenchU64Map_contains(&map, bench_key(n + bench_rand(&seed) % n));
+    row.miss = (bench_now_ns() - t0) / LOOKUPS;
+
+    bench_sink += (uintptr_t)acc;
+    BenchU64Map_free(&map);
+    return row;
+}
+
+static char text[2 * STR_KEYS][STR_BYTES];
+static TL_StrView views[2 * STR_KEYS];
+
+static MapBenchRow
+bench_strview(size_t n)
+{
+    MapBenchRow row;
+    TL_Map map;
+    uint64_t seed = 9;
+    size_t acc = 0;
+    double t0;
+    size_t i;
+
+    tl_map_init_strview(map, size_t, NULL);
+    t0 = bench_now_ns();
+    for (i = 0; i < n; ++i) tl_map_put(map, views[i], i);
+    row.insert = (bench_now_ns() - t0) / (double)n;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += *tl_map_get_const_strview(map, views[bench_rand(&seed) % n], size_t);
+    row.hit = (bench_now_ns() - t0) / LOOKUPS;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += tl_map_get_const_strview(map, views[n + bench_rand(&seed) % n], size_t) != NULL;
+    row.miss = (bench_now_ns() - t0) / LOOKUPS;
+
+    bench_sink += acc;
+    tl_map_free(map);
+    return row;
+}
+
+static void
+bench_churn(size_t n)
+{
+    static double samples[CHURN_OPS];
+    TL_MapProbeStats probe;
+    TL_Map map;
+    double sum = 0.0;
+    double p99;
+    size_t i;
+
+    tl_map_init_bytewise(map, u64_t, u64_t, NULL);
+    for (i = 0; i < n; ++i) tl_map_put(map, bench_key(i), (u64_t)i);
+
+    for (i = 0; i < CHURN_OPS; ++i) {
+        double t0 = bench_now_ns();
+
+        tl_map_remove(map, bench_key(i));
+        tl_map_put(map, bench_key(n + i), (u64_t)i);
+        samples[i] = bench_now_ns() - t0;
+        sum += samples[i];
+    }
+
+    probe = tl_map_probe_stats(map);
+    p99 = bench_percentile(samples, CHURN_OPS, 0.99, 0);
+    printf("  %10zu %8.1f %8.1f %10.1f %8.2f %6zu", n, sum / CHURN_OPS, p99,
+           bench_percentile(samples, CHURN_OPS, 1.0, 1) / 1000.0, probe.mean, probe.max);
+    for (i = 0; i < TL_MAP_PROBE_BUCKETS; ++i) printf(" %8zu", probe.hist[i]);
+    printf("\n");
+    tl_map_free(map);
+}
+
+static void
+bench_grow(size_t n, size_t step)
+{
+    static double samples[(size_t)8 << 20];
+    TL_Map map;
+    double sum = 0.0;
+    double p999;
+    size_t i;
+
+    n = TL_MIN(n, TL_COUNT_OF(samples));
+    tl_map_init_bytewise(map, u64_t, u64_t, NULL);
+    tl_map_set_incremental(map, step);
+    for (i = 0; i < n; ++i) {
+        double t0 = bench_now_ns();
+
+        tl_map_put(map, bench_key(i), (u64_t)i);
+        samples[i] = bench_now_ns() - t0;
+        sum += samples[i];
+    }
+
+    p999 = bench_percentile(samples, n, 0.999, 0);
+    printf("  %10zu %-12s %8.1f %8.1f %10.1f\n", n, step ? "incremental" : "all at once",
+           sum / (double)n, p999, bench_percentile(samples, n, 1.0, 1) / 1000.0);
+    tl_map_free(map);
+}
+
+static MapBenchRow
+bench_strview_typed(size_t n)
+{
+    MapBenchRow row;
+    BenchStrMap map;
+    uint64_t seed = 9;
+    size_t acc = 0;
+    double t0;
+    size_t i;
+
+    BenchStrMap_init(&map, NULL);
+    t0 = bench_now_ns();
+    for (i = 0; i < n; ++i) BenchStrMap_put(&map, views[i], i);
+    row.insert = (bench_now_ns() - t0) / (double)n;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += *BenchStrMap_get_const(&map, views[bench_rand(&seed) % n]);
+    row.hit = (bench_now_ns() - t0) / LOOKUPS;
+
+    t0 = bench_now_ns();
+    for (i = 0; i < LOOKUPS; ++i) acc += BenchStrMap_contains(&map, views[n + bench_rand(&seed) % n]);
+    row.miss = (bench_now_ns() - t0) / LOOKUPS;
+
+    bench_sink += acc;
+    BenchStrMap_free(&map);
+    return row;
+}
+
+static void
+bench_print_row(const char *key, const char *kind, size_t n, MapBenchRow r)
+{
+    printf("  %-8s %-8s %10zu %10.1f %10.1f %10.1f\n", key, kind, n, r.insert, r.hit, r.miss);
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t max_keys = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : (size_t)8 << 20;
+    size_t n;
+
+    if (!bench_check(0, 1) || !bench_check(1, 2) || !bench_check(REHASH_STEP, 3) || !bench_check_drain()
+     || !bench_check_grow(1) || !bench_check_grow(2)
+     || !BenchU64Map_check(CHECK_KEYS, CHECK_OPS, 4, 0) || !BenchClusterMap_check(2048, 100000, 5, 1)) {
+        return 1;
+    }
+
+    for (n = 0; n < 2 * STR_KEYS; ++n) {
+        size_t len = 16 + n % (STR_BYTES - 16);
+
+        memset(text[n], 'x', len);
+        memcpy(text[n], "session:", 8);
+        /* index last, so keys differ only near the end */
+        memcpy(text[n] + len - sizeof(n), &n, sizeof(n));
+        views[n] = (TL_StrView){ .data = text[n], .beg = 0, .end = len };
+    }
+
+    printf("== ns/op\n");
+    printf("  %-8s %-8s %10s %10s %10s %10s\n", "key", "map", "entries", "insert", "hit", "miss");
+    for (n = (size_t)1 << 16; n <= max_keys; n *= 8) {
+        bench_print_row("u64", "generic", n, bench_u64(n));
+        bench_print_row("u64", "typed", n, bench_u64_typed(n));
+    }
+    for (n = (size_t)1 << 16; n <= TL_MIN(max_keys, (size_t)STR_KEYS); n *= 4) {
+        bench_print_row("strview", "generic", n, bench_strview(n));
+        bench_print_row("strview", "typed", n, bench_strview_typed(n));
+    }
+
+    printf("== churn: %d remove+insert pairs (ns/op; max in us); distance from home\n", CHURN_OPS);
+    printf("  %10s %8s %8s %10s %8s %6s %8s %8s %8s %8s %8s %8s %8s %8s\n", "entries", "mean", "p99",
+           "max us", "dist", "max", "0", "1", "2-3", "4-7", "8-15", "16-31", "32-63", ">=64");
+    for (n = (size_t)1 << 16; n <= max_keys; n *= 8) bench_churn(n);
+
+    printf("== grow: puts into an empty map (ns/op; max in us)\n");
+    printf("  %10s %-12s %8s %8s %10s\n", "entries", "rehash", "mean", "p99.9", "max us");
+    for (n = (size_t)1 << 16; n <= max_keys; n *= 8) {
+        bench_grow(n, 0);
+        bench_grow(n, REHASH_STEP);
+    }
+    return 0;
+}
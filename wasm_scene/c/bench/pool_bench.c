@@ -0,0 +1,182 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * pool_bench.c
+ *   TL_ConcurrentFixedPool vs a TL_FixedPool behind a mutex (and malloc).
+ *
+ *   Usage:
+ *     target/bench/pool_bench [local|cross]
+ *
+ *   local: each thread allocates a batch of 64B blocks and frees them itself.
+ *   cross: each thread allocates a batch, then frees its neighbour's batch,
+ *          so every block is freed on a thread other than its allocator.
+ *
+ *   ns/op is wall time over all threads' allocs + frees.
+ */
+#include <pthread.h>
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    POOL_MAX_THREADS = 8,
+    POOL_BLOCK       = 64,
+    POOL_BATCH       = 4096,
+    POOL_ROUNDS      = 100,
+};
+
+typedef enum {
+    POOL_MUTEX,
+    POOL_CONCURRENT,
+    POOL_MALLOC,
+} PoolKind;
+
+static const char *const pool_kind_names[] = { "mutex pool", "concurrent pool", "malloc" };
+
+typedef struct PoolCtx {
+    PoolKind kind;
+    b32_t cross;
+    int nthreads;
+    TL_FixedPool pool;
+    pthread_mutex_t lock;
+    TL_ConcurrentFixedPool cpool;
+    pthread_barrier_t barrier;
+    void *blocks[POOL_MAX_THREADS][POOL_BATCH];
+} PoolCtx;
+
+typedef struct PoolThread {
+    PoolCtx *ctx;
+    int id;
+} PoolThread;
+
+static inline
+void *
+pool_alloc(PoolCtx *ctx)
+{
+    void *p = NULL;
+
+    switch (ctx->kind) {
+    case POOL_MUTEX:
+        pthread_mutex_lock(&ctx->lock);
+        p = tl_fixed_pool_alloc(&ctx->pool, POOL_BLOCK, TL_MEM_ALIGN);
+        pthread_mutex_unlock(&ctx->lock);
+        break;
+    case POOL_CONCURRENT:
+        p = tl_concurrent_fixed_pool_alloc(&ctx->cpool, POOL_BLOCK, TL_MEM_ALIGN);
+        break;
+    case POOL_MALLOC:
+        p = malloc(POOL_BLOCK);
+        break;
+    }
+    if (!p) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    *(volatile byte_t *)p = 1;
+    return p;
+}
+
+static inline
+void
+pool_free(PoolCtx *ctx, void *p)
+{
+    switch (ctx->kind) {
+    case POOL_MUTEX:
+        pthread_mutex_lock(&ctx->lock);
+        tl_fixed_pool_free(&ctx->pool, p);
+        pthread_mutex_unlock(&ctx->lock);
+        break;
+    case POOL_CONCURRENT:
+        tl_concurrent_fixed_pool_free(&ctx->cpool, p);
+        break;
+    case POOL_MALLOC:
+        free(p);
+        break;
+    }
+}
+
+static void *
+pool_worker(void *arg)
+{
+    PoolThread *self = arg;
+    PoolCtx *ctx = self->ctx;
+    int victim = ctx->cross ? (self->id + 1) % ctx->nthreads : self->id;
+    int r, i;
+
+    for (r = 0; r < POOL_ROUNDS; ++r) {
+        for (i = 0; i < POOL_BATCH; ++i) ctx->blocks[self->id][i] = pool_alloc(ctx);
+        if (ctx->cross) pthread_barrier_wait(&ctx->barrier);
+        for (i = 0; i < POOL_BATCH; ++i) pool_free(ctx, ctx->blocks[victim][i]);
+        if (ctx->cross) pthread_barrier_wait(&ctx->barrier);
+    }
+
+    if (ctx->kind == POOL_CONCURRENT) tl_concurrent_fixed_pool_thread_flush(&ctx->cpool);
+    return NULL;
+}
+
+static double
+pool_run(PoolCtx *ctx, PoolKind kind, int nthreads)
+{
+    pthread_t threads[POOL_MAX_THREADS];
+    PoolThread self[POOL_MAX_THREADS];
+    double t0, elapsed;
+    int i;
+
+    ctx->kind = kind;
+    ctx->nthreads = nthreads;
+    tl_fixed_pool_init(&ctx->pool, POOL_BLOCK, TL_MEM_ALIGN, 1024);
+    tl_concurrent_fixed_pool_init(&ctx->cpool, POOL_BLOCK, TL_MEM_ALIGN, 1024);
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_barrier_init(&ctx->barrier, NULL, (unsigned)nthreads);
+
+    t0 = bench_now_ns();
+    for (i = 0; i < nthreads; ++i) {
+        self[i] = (PoolThread){ .ctx = ctx, .id = i };
+        pthread_create(&threads[i], NULL, pool_worker, &self[i]);
+    }
+    for (i = 0; i < nthreads; ++i) pthread_join(threads[i], NULL);
+    elapsed = bench_now_ns() - t0;
+
+    pthread_barrier_destroy(&ctx->barrier);
+    pthread_mutex_destroy(&ctx->lock);
+    tl_concurrent_fixed_pool_destroy(&ctx->cpool);
+    tl_fixed_pool_destroy(&ctx->pool);
+
+    return elapsed / ((double)nthreads * POOL_ROUNDS * POOL_BATCH * 2);
+}
+
+int
+main(int argc, char **argv)
+{
+    static PoolCtx ctx;
+    static const char *const modes[] = { "local", "cross" };
+    size_t m;
+    int nthreads;
+    int ran = 0;
+
+    for (m = 0; m < TL_COUNT_OF(modes); ++m) {
+        if (argc > 1 && strcmp(argv[1], modes[m]) != 0) continue;
+        ran = 1;
+        ctx.cross = m == 1;
+
+        printf("== %s: %d x %dB blocks per thread per round\n", modes[m], POOL_BATCH, POOL_BLOCK);
+        printf("  %-8s %16s %16s %16s   (ns/op)\n",
+               "threads", pool_kind_names[0], pool_kind_names[1], pool_kind_names[2]);
+
+        for (nthreads = 1; nthreads <= POOL_MAX_THREADS; nthreads *= 2) {
+            double t_mutex = pool_run(&ctx, POOL_MUTEX, nthreads);
+            double t_conc = pool_run(&ctx, POOL_CONCURRENT, nthreads);
+            double t_malloc = pool_run(&ctx, POOL_MALLOC, nthreads);
+
+            printf("  %-8d %16.2f %16.2f %16.2f\n", nthreads, t_mutex, t_conc, t_malloc);
+        }
+    }
+
+    if (!ran) {
+        fprintf(stderr, "unknown mode '%s'\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * slab_bench.c
+ *   TL_SlabAllocator vs the std (glibc malloc) allocator through TL_Allocator.
+ *
+ *   Usage:
+ *     target/bench/slab_bench
+ *
+ *   small:  100k allocations of 8B..256B, freed in random order
+ *   arrays: many short tl_arr token arrays grown one push at a time
+ *   maps:   many small TL_Maps filled, probed and freed
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    SMALL_COUNT = 100000, SMALL_ROUNDS = 20,
+    ARR_COUNT   = 20000,  ARR_MAX_LEN  = 48,  ARR_ROUNDS = 10,
+    MAP_COUNT   = 10000,  MAP_ENTRIES  = 12,  MAP_ROUNDS = 10,
+};
+
+typedef struct Token {
+    int kind;
+    int beg;
+    int end;
+} Token;
+
+static double
+bench_small(TL_Allocator *a)
+{
+    static void *ptrs[SMALL_COUNT];
+    static size_t sizes[SMALL_COUNT];
+    static int order[SMALL_COUNT];
+    uint64_t seed = 42;
+    double t0;
+    int r, i;
+
+    for (i = 0; i < SMALL_COUNT; ++i) {
+        sizes[i] = 8 + (size_t)(bench_rand(&seed) % 249);
+        order[i] = i;
+    }
+    for (i = SMALL_COUNT - 1; i > 0; --i) {
+        int j = (int)(bench_rand(&seed) % (uint64_t)(i + 1));
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    t0 = bench_now_ns();
+    for (r = 0; r < SMALL_ROUNDS; ++r) {
+        for (i = 0; i < SMALL_COUNT; ++i) {
+            ptrs[i] = tl_allocator_alloc(a, sizes[i]);
+            *(volatile byte_t *)ptrs[i] = 1;
+        }
+        for (i = 0; i < SMALL_COUNT; ++i) {
+            tl_allocator_free(a, ptrs[order[i]], sizes[order[i]]);
+        }
+    }
+    return (bench_now_ns() - t0) / ((double)SMALL_ROUNDS * SMALL_COUNT * 2);
+}
+
+static double
+bench_arrays(TL_Allocator *a)
+{
+    static Token *arrs[ARR_COUNT];
+    uint64_t seed = 7;
+    size_t ops = 0;
+    double t0;
+    int r, i, j;
+
+    t0 = bench_now_ns();
+    for (r = 0; r < ARR_ROUNDS; ++r) {
+        for (i = 0; i < ARR_COUNT; ++i) {
+            int len = 1 + (int)(bench_rand(&seed) % ARR_MAX_LEN);
+
+            arrs[i] = NULL;
+            tl_arr_init(arrs[i], a);
+            for (j = 0; j < len; ++j) {
+                Token t = { j, j, j + 1 };
+                tl_arr_push(arrs[i], t);
+            }
+            ops += (size_t)len;
+        }
+        for (i = 0; i < ARR_COUNT; ++i) {
+            bench_sink += (uintptr_t)tl_arr_len(arrs[i]);
+            tl_arr_free(arrs[i]);
+        }
+    }
+    return (bench_now_ns() - t0) / (double)ops;
+}
+
+static double
+bench_maps(TL_Allocator *a)
+{
+    static TL_Map maps[MAP_COUNT];
+    double t0;
+    int r, i, k;
+
+    t0 = bench_now_ns();
+    for (r = 0; r < MAP_ROUNDS; ++r) {
+        for (i = 0; i < MAP_COUNT; ++i) {
+            tl_map_init_bytewise(maps[i], int, int, a);
+            for (k = 0; k < MAP_ENTRIES; ++k) tl_map_put(maps[i], k * 31 + i, k);
+        }
+        for (i = 0; i < MAP_COUNT; ++i) {
+            for (k = 0; k < MAP_ENTRIES; ++k) {
+                bench_sink += (uintptr_t)tl_map_get_const(maps[i], k * 31 + i, int);
+            }
+            tl_map_free(maps[i]);
+        }
+    }
+    return (bench_now_ns() - t0) / ((double)MAP_ROUNDS * MAP_COUNT * MAP_ENTRIES);
+}
+
+int
+main(void)
+{
+    static const struct {
+        const char *name;
+        const char *unit;
+        double (*run)(TL_Allocator *a);
+    } cases[] = {
+        { "small 8..256B", "ns/op",    bench_small },
+        { "token arrays",  "ns/push",  bench_arrays },
+        { "small maps",    "ns/entry", bench_maps },
+    };
+    TL_Allocator std_alloc = tl_default_allocator;
+    TL_SlabAllocator slab;
+    TL_Allocator slab_alloc;
+    size_t i;
+
+    if (!tl_slab_init(&slab)) return 1;
+    slab_alloc = tl_get_allocator_slab(&slab);
+
+    printf("  %-16s %12s %12s\n", "workload", "std", "slab");
+    for (i = 0; i < TL_COUNT_OF(cases); ++i) {
+        double t_std = cases[i].run(&std_alloc);
+        double t_slab = cases[i].run(&slab_alloc);
+
+        printf("  %-16s %12.2f %12.2f   %s\n", cases[i].name, t_std, t_slab, cases[i].unit);
+    }
+
+    tl_slab_destroy(&slab);
+    return 0;
+}
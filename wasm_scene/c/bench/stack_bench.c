@@ -0,0 +1,140 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * stack_bench.c
+ *   TL_StackAlloc vs malloc and TL_Arena on LIFO workloads, all through
+ *   TL_Allocator.
+ *
+ *   Usage:
+ *     target/bench/stack_bench
+ *
+ *   descent: a recursive walk that allocates a node scratch buffer on the
+ *            way down and frees it on the way back up, over many trees.
+ *   matrix:  a loop that allocates temporaries, grows the newest one by
+ *            realloc and frees them in reverse order.
+ *
+ *   The arena never reclaims inside a run, so its footprint grows with the
+ *   work done; the stack only ever holds the live blocks, whose peak is
+ *   measured with a tracking allocator.
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    TREES        = 2000,
+    TREE_DEPTH   = 8,
+    MATRIX_LOOPS = 200000,
+    STACK_BYTES  = 1 << 20,
+};
+
+typedef struct StackBenchCtx {
+    TL_Allocator *a;
+    uint64_t seed;
+    size_t ops;
+} StackBenchCtx;
+
+static void
+bench_descend(StackBenchCtx *ctx, int depth)
+{
+    size_t size = 32 + (size_t)(bench_rand(&ctx->seed) % 480);
+    byte_t *node = tl_allocator_alloc(ctx->a, size);
+    int children;
+
+    node[0] = (byte_t)depth;
+    ++ctx->ops;
+    if (depth < TREE_DEPTH) {
+        children = 1 + (int)(bench_rand(&ctx->seed) % 2);
+        while (children--) bench_descend(ctx, depth + 1);
+    }
+    bench_sink += node[0];
+    tl_allocator_free(ctx->a, node, size);
+}
+
+static double
+bench_run_descent(TL_Allocator *a)
+{
+    StackBenchCtx ctx = { .a = a, .seed = 11 };
+    double t0 = bench_now_ns();
+    int i;
+
+    for (i = 0; i < TREES; ++i) bench_descend(&ctx, 0);
+    return (bench_now_ns() - t0) / (double)ctx.ops;
+}
+
+static double
+bench_run_matrix(TL_Allocator *a)
+{
+    uint64_t seed = 5;
+    double t0 = bench_now_ns();
+    int i;
+
+    for (i = 0; i < MATRIX_LOOPS; ++i) {
+        size_t n = 4 + (size_t)(bench_rand(&seed) % 12);
+        double *m = tl_allocator_alloc(a, n * n * sizeof(double));
+        double *v = tl_allocator_alloc(a, n * sizeof(double));
+        double *w;
+
+        m[0] = 1.0;
+        v[0] = 2.0;
+        w = tl_allocator_realloc(a, v, n * sizeof(double), 2 * n * sizeof(double));
+        bench_sink += (uintptr_t)(m[0] + w[0]);
+        tl_allocator_free(a, w, 2 * n * sizeof(double));
+        tl_allocator_free(a, m, n * n * sizeof(double));
+    }
+    return (bench_now_ns() - t0) / ((double)MATRIX_LOOPS * 3);
+}
+
+static size_t
+bench_arena_used(const TL_Arena *arena)
+{
+    const TL_ArenaChunk *chunk;
+    size_t used = 0;
+
+    for (chunk = arena->chunks; chunk; chunk = chunk->next) used += chunk->used;
+    return used;
+}
+
+int
+main(void)
+{
+    static const struct {
+        const char *name;
+        double (*run)(TL_Allocator *a);
+    } cases[] = {
+        { "descent", bench_run_descent },
+        { "matrix",  bench_run_matrix },
+    };
+    static byte_t stack_mem[STACK_BYTES];
+    TL_Allocator std_alloc = tl_default_allocator;
+    size_t i;
+
+    printf("  %-10s %10s %10s %10s %12s %12s\n",
+           "workload", "malloc", "arena", "stack", "arena KB", "live peak KB");
+    for (i = 0; i < TL_COUNT_OF(cases); ++i) {
+        TL_Arena arena = {0};
+        TL_Allocator arena_alloc = tl_get_allocator_arena(&arena);
+        TL_StackAlloc stack;
+        TL_Allocator stack_alloc;
+        TL_AllocStats stats = {0};
+        TL_Allocator tracked;
+        double t_malloc, t_arena, t_stack;
+        size_t arena_kb;
+
+        tl_stack_init(&stack, stack_mem, sizeof(stack_mem));
+        stack_alloc = tl_get_allocator_stack(&stack);
+        tracked = tl_get_allocator_tracking(&std_alloc, &stats);
+
+        t_malloc = cases[i].run(&std_alloc);
+        t_arena = cases[i].run(&arena_alloc);
+        arena_kb = bench_arena_used(&arena) / BENCH_KB;
+        t_stack = cases[i].run(&stack_alloc);
+        cases[i].run(&tracked);
+
+        printf("  %-10s %10.2f %10.2f %10.2f %12zu %12.1f   ns/op\n", cases[i].name,
+               t_malloc, t_arena, t_stack, arena_kb, (double)stats.peak_bytes / BENCH_KB);
+        tl_arena_destroy(&arena);
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/* vim: set ft=c : -*- mode: c -*-
+ * tlsf_bench.c
+ *   Worst-case alloc/free latency of TL_TlsfAllocator vs malloc under
+ *   fragmentation-heavy workloads.
+ *
+ *   Usage:
+ *     target/bench/tlsf_bench [random|phases]
+ *
+ *   random: a live set of LIVE_SLOTS blocks, log-uniform 16B..64KB; each op
+ *           frees a random slot and refills it with a new size.
+ *   phases: the same, but the size range flips between 16B..256B and
+ *           4KB..64KB every PHASE_OPS ops, so large holes are chopped up by
+ *           small blocks and then asked for again.
+ *
+ *   Every op runs once untimed to warm up (page faults, heap growth), then
+ *   again timed. Latencies are per call, minus the timer overhead.
+ */
+#include <string.h>
+
+#include "tinylib/tinylib.h"
+#include "tinylib/tinylib.c"
+
+#include "bench_common.h"
+
+enum {
+    LIVE_SLOTS = 10000,
+    BENCH_OPS  = 500000,
+    PHASE_OPS  = 50000,
+};
+
+#define TLSF_POOL_BYTES ((size_t)512 * BENCH_MB)
+
+typedef struct BenchAlloc {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void (*free)(void *ptr);
+} BenchAlloc;
+
+static TL_TlsfAllocator tlsf;
+static void *slots[LIVE_SLOTS];
+static double alloc_ns[BENCH_OPS];
+static double free_ns[BENCH_OPS];
+
+static void *bench_malloc(size_t size) { return malloc(size); }
+static void bench_mfree(void *ptr) { free(ptr); }
+static void *bench_tlsf_alloc(size_t size) { return tl_tlsf_alloc(&tlsf, size, TL_MEM_ALIGN); }
+static void bench_tlsf_free(void *ptr) { tl_tlsf_free(&tlsf, ptr); }
+
+/* log-uniform in [lo, hi] */
+static size_t
+bench_size(uint64_t *seed, int lo_log2, int hi_log2)
+{
+    int bits = lo_log2 + (int)(bench_rand(seed) % (uint64_t)(hi_log2 - lo_log2));
+    size_t base = (size_t)1 << bits;
+    return base + (size_t)(bench_rand(seed) % base);
+}
+
+static size_t
+bench_next_size(uint64_t *seed, b32_t phases, size_t op)
+{
+    if (!phases) return bench_size(seed, 4, 16);
+    return (op / PHASE_OPS) % 2 ? bench_size(seed, 12, 16) : bench_size(seed, 4, 8);
+}
+
+static void
+bench_pass(const BenchAlloc *a, b32_t phases, b32_t timed, double timer_ns)
+{
+    uint64_t seed = 2024;
+    size_t i;
+
+    for (i = 0; i < LIVE_SLOTS; ++i) {
+        slots[i] = a->alloc(bench_next_size(&seed, phases, 0));
+        *(volatile byte_t *)slots[i] = 1;
+    }
+
+    for (i = 0; i < BENCH_OPS; ++i) {
+        size_t k = (size_t)(bench_rand(&seed) % LIVE_SLOTS);
+        size_t size = bench_next_size(&seed, phases, i);
+        double t0, t1, t2;
+
+        t0 = bench_now_ns();
+        a->free(slots[k]);
+        t1 = bench_now_ns();
+        slots[k] = a->alloc(size);
+        t2 = bench_now_ns();
+
+        if (!slots[k]) {
+            fprintf(stderr, "%s: out of memory\n", a->name);
+            exit(1);
+        }
+        *(volatile byte_t *)slots[k] = 1;
+        if (timed) {
+            free_ns[i] = TL_MAX(t1 - t0 - timer_ns, 0.0);
+            alloc_ns[i] = TL_MAX(t2 - t1 - timer_ns, 0.0);
+        }
+    }
+
+    for (i = 0; i < LIVE_SLOTS; ++i) a->free(slots[i]);
+}
+
+static void
+bench_print(const char *name, const char *op, double *samples)
+{
+    double sum = 0.0;
+    double p50;
+    size_t i;
+
+    for (i = 0; i < BENCH_OPS; ++i) sum += samples[i];
+    p50 = bench_percentile(samples, BENCH_OPS, 0.50, 0);
+    printf("  %-8s %-6s %8.1f %8.1f %8.1f %8.1f %10.1f\n", name, op,
+           sum / BENCH_OPS, p50,
+           bench_percentile(samples, BENCH_OPS, 0.99, 1),
+           bench_percentile(samples, BENCH_OPS, 0.999, 1),
+           bench_percentile(samples, BENCH_OPS, 1.0, 1));
+}
+
+int
+main(int argc, char **argv)
+{
+    static const BenchAlloc allocs[] = {
+        { "malloc", bench_malloc, bench_mfree },
+        { "tlsf",   bench_tlsf_alloc, bench_tlsf_free },
+    };
+    static const char *const modes[] = { "random", "phases" };
+    double timer_ns = bench_timer_overhead_ns();
+    size_t m, i;
+    int ran = 0;
+
+    if (!tl_tlsf_init_mapped(&tlsf, TLSF_POOL_BYTES)) {
+        fprintf(stderr, "tlsf: cannot map %zu MB\n", TLSF_POOL_BYTES / BENCH_MB);
+        return 1;
+    }
+
+    for (m = 0; m < TL_COUNT_OF(modes); ++m) {
+        if (argc > 1 && strcmp(argv[1], modes[m]) != 0) continue;
+        ran = 1;
+
+        printf("== %s: %d live blocks, %d ops (ns)\n", modes[m], LIVE_SLOTS, BENCH_OPS);
+        printf("  %-8s %-6s %8s %8s %8s %8s %10s\n", "", "op", "mean", "p50", "p99", "p99.9", "max");
+        for (i = 0; i < TL_COUNT_OF(allocs); ++i) {
+            bench_pass(&allocs[i], m == 1, 0, timer_ns);
+            bench_pass(&allocs[i], m == 1, 1, timer_ns);
+            bench_print(allocs[i].name, "alloc", alloc_ns);
+            bench_print(allocs[i].name, "free", free_ns);
+        }
+    }
+
+    tl_tlsf_destroy(&tlsf);
+    if (!ran) {
+        fprintf(stderr, "unknown mode '%s'\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
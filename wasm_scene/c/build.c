@@ -4,7 +4,7 @@
  *    cc -o build build.c && ./build
  *
  *  Usage:
- *    ./build [debug|release|clean]
+ *    ./build [debug|release|bench|clean]
  */
 
 #define TL_SHORT_NAMES
@@ -126,6 +126,61 @@ build_release(void)
     return tl_build_target_finish("release", result);
 }
 
+/* Benchmarks are native-only and always optimised; CArena is compiled in
+ * from the sibling project so its Arena can be measured alongside tinylib. */
+static
+bool
+build_bench(void)
+{
+    static const char *benches[] = {
+        "alloc_bench",
+        "arena_bench",
+        "buddy_bench",
+        "fixed_pool_bench",
+        "hash_bench",
+        "map_bench",
+        "pool_bench",
+        "slab_bench",
+        "stack_bench",
+        "tlsf_bench",
+    };
+    CmdResult result = { .ok = true };
+    size_t    i;
+
+    mkdir_if_needed("target");
+    mkdir_if_needed("target/bench");
+
+    for (i = 0; i < TL_COUNT_OF(benches) && result.ok; ++i) {
+        CompileCmd cmd = {0};
+        char       src[256];
+        char       out[256];
+
+        snprintf(src, sizeof(src), "bench/%s.c", benches[i]);
+        snprintf(out, sizeof(out), "target/bench/%s", benches[i]);
+
+        compile_cmd_init(&cmd, NULL);
+        compile_set_standard(&cmd, TL_C_STD_GNU11);
+        compile_include(&cmd, "include");
+        compile_include(&cmd, "../../CArena/src");
+        compile_sources(&cmd, src, "../../CArena/src/arena.c");
+        compile_apply_preset(&cmd, &tl_compile_preset_release);
+        compile_flags(&cmd, "-march=native");
+        compile_libs(&cmd, "pthread");
+        compile_set_output(&cmd, out);
+
+        result = compile_run(&cmd);
+    }
+
+    for (i = 0; i < TL_COUNT_OF(benches) && result.ok; ++i) {
+        char out[256];
+
+        snprintf(out, sizeof(out), "target/bench/%s", benches[i]);
+        result = cmd(out);
+    }
+
+    return tl_build_target_finish("bench", result);
+}
+
 static
 bool
 build_clean(void)
@@ -139,6 +194,7 @@ main(int argc, char **argv)
     static const BuildTarget targets[] = {
         { "debug",   build_debug },
         { "release", build_release },
+        { "bench",   build_bench },
         { "clean",   build_clean },
     };
 
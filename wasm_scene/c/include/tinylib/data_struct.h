@@ -15,6 +15,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if !defined(TL_MAP_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TL_MAP__SSE2 1
+#include <emmintrin.h>
+#endif
+
 #ifdef TL_DS_DEBUG_PRINT
 #include <stdio.h>
 #define TL_DS__PRINT(fmt, ...) fprintf(stderr, "[TL_DS] %s:%d %s " fmt "\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__)
@@ -582,10 +588,40 @@ tl__arr_free_impl(void *arr, size_t elem_size, size_t align)
 /* Hash map                                                                   */
 /* -------------------------------------------------------------------------- */
 
+/* Each slot has one control byte in `states`: TL_MAP_EMPTY, or, for a full
+ * slot, the top 7 bits of the key's hash (high bit clear). The low hash bits
+ * pick the home slot, and probing is linear, but it compares TL_MAP_GROUP
+ * control bytes against the wanted 7 bits at once (SSE2, or a SWAR version
+ * on two 64-bit words), so `eq` only runs on the ~1/128 of full slots whose
+ * hash bits match. The first TL_MAP_GROUP - 1 control bytes are mirrored
+ * past the end of `states`, so a group loaded at any slot reads straight
+ * through the wrap-around. Define TL_MAP_NO_SIMD to force SWAR.
+ *
+ * Inserts are Robin Hood: a key takes the first slot whose entry sits closer
+ * to its own home than the key would, and the rest of the run shifts right.
+ * Removes shift the following run back by one until an empty slot or an
+ * entry already at home, so there are no tombstones and a run only ever
+ * holds live keys. `dists` keeps each entry's distance from home so neither
+ * needs to rehash keys; TL_MAP_DIST_SAT there means "that far or more, ask
+ * the hash".
+ *
+ * Growing normally moves every entry at once. After
+ * tl_map_set_incremental(map, step) the old table is kept beside the new one
+ * instead, as Redis does for its dicts: lookups search both, new keys go to
+ * the new one, and every put, get_mut and remove first moves up to `step`
+ * old slots across. tl_map_rehash_step() does the same on demand, e.g. when
+ * idle. Const lookups only read, so they never advance it. Any step works,
+ * 1 included: when `step` alone would not empty the old table before the
+ * new one grows, ops take the larger share needed (3 slots per put right
+ * after a grow), so a grow never has to finish a migration. Old slots are
+ * drained in order with the backward-shift remove, which keeps the old table
+ * a valid table and everything below the cursor empty. */
 #define TL_MAP_MIN_CAP 16U
-#define TL_MAP_EMPTY 0U
-#define TL_MAP_FULL  1U
-#define TL_MAP_TOMB  2U
+#define TL_MAP_GROUP   16U
+#define TL_MAP_EMPTY   0x80U
+#define TL_MAP_IS_FULL(ctrl) (((ctrl) & 0x80U) == 0U)
+#define TL_MAP_DIST_SAT 0xFFU
+#define TL_MAP_PROBE_BUCKETS 8 /* 0, 1, 2-3, 4-7, ..., 32-63, >=64 slots from home */
 
 typedef u64_t (*TL_MapHashFn)(const void *key, size_t key_size);
 typedef b32_t (*TL_MapEqFn)(const void *lhs, const void *rhs, size_t key_size);
@@ -593,7 +629,6 @@ typedef b32_t (*TL_MapEqFn)(const void *lhs, const void *rhs, size_t key_size);
 typedef struct TL_Map {
     size_t len;
     size_t cap;
-    size_t tombs;
     size_t key_size;
     size_t key_align;
     size_t key_stride;
@@ -606,12 +641,41 @@ typedef struct TL_Map {
     byte_t *keys;
     byte_t *values;
     byte_t *states;
+    byte_t *dists;
+    struct TL_Map *old;  /* table being migrated from, or NULL */
+    size_t migrate_pos;  /* old slots below this are empty */
+    size_t rehash_step;  /* old slots moved per op; 0 rehashes all at once */
 } TL_Map;
 
+typedef struct TL_MapProbeStats {
+    size_t len;
+    size_t cap;
+    size_t max;                        /* longest distance from home */
+    double mean;
+    size_t hist[TL_MAP_PROBE_BUCKETS];
+} TL_MapProbeStats;
+
+/* Hashing. tl_hash_bytes() is a wyhash-style 64-bit hash: keys up to 16
+ * bytes are read as two overlapping 4- or 8-byte words, longer keys are
+ * consumed 48 bytes per step on three independent lanes, and every step is
+ * one 64x64->128 multiply. tl_hash_u32/u64 hash a single word directly.
+ * Byte-at-a-time FNV-1a stays available as tl_hash_fnv1a(); define
+ * TL_HASH_USE_FNV to make it the default again, or pass
+ * tl_map_hash_fnv1a_key to tl_map_init_ex() for a single map.
+ * Words are read in native byte order, so hashes differ across endianness
+ * and must not be persisted. */
+
+#define TL_HASH_SEED UINT64_C(0)
+
+#define TL_HASH__S0 UINT64_C(0x2d358dccaa6c78a5)
+#define TL_HASH__S1 UINT64_C(0x8bb84b93962eacc9)
+#define TL_HASH__S2 UINT64_C(0x4b33a62ed433d4a3)
+#define TL_HASH__S3 UINT64_C(0x4d5a2da51de1aa47)
+
 TL_ATTR_MAYBE_UNUSED
 static inline
 u64_t
-tl_hash_bytes(const void *data, size_t size)
+tl_hash_fnv1a(const void *data, size_t size)
 {
     const byte_t *bytes = (const byte_t *)data;
     u64_t hash = UINT64_C(1469598103934665603);
@@ -624,6 +688,141 @@ tl_hash_bytes(const void *data, size_t size)
     return hash;
 }
 
+/* 64x64 -> 128 multiply; *a gets the low half, *b the high half. */
+static inline
+void
+tl__hash_mum(u64_t *a, u64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (u64_t)r;
+    *b = (u64_t)(r >> 64);
+#else
+    u64_t ha = *a >> 32, hb = *b >> 32, la = (u32_t)*a, lb = (u32_t)*b;
+    u64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    u64_t t = rl + (rm0 << 32);
+    u64_t c = t < rl;
+    u64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline
+u64_t
+tl__hash_mix(u64_t a, u64_t b)
+{
+    tl__hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline
+u64_t
+tl__hash_r8(const byte_t *p)
+{
+    u64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline
+u64_t
+tl__hash_r4(const byte_t *p)
+{
+    u32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* 1..3 bytes: first, middle and last byte */
+static inline
+u64_t
+tl__hash_r3(const byte_t *p, size_t size)
+{
+    return ((u64_t)p[0] << 16) | ((u64_t)p[size >> 1] << 8) | p[size - 1];
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+u64_t
+tl_hash_wy(const void *data, size_t size, u64_t seed)
+{
+    const byte_t *p = (const byte_t *)data;
+    u64_t a, b;
+
+    seed ^= tl__hash_mix(seed ^ TL_HASH__S0, TL_HASH__S1);
+    if (size <= 16) {
+        if (size >= 4) {
+            size_t mid = (size >> 3) << 2;
+            a = (tl__hash_r4(p) << 32) | tl__hash_r4(p + mid);
+            b = (tl__hash_r4(p + size - 4) << 32) | tl__hash_r4(p + size - 4 - mid);
+        } else if (size > 0) {
+            a = tl__hash_r3(p, size);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = size;
+
+        if (i > 48) {
+            u64_t see1 = seed, see2 = seed;
+            do {
+                seed = tl__hash_mix(tl__hash_r8(p) ^ TL_HASH__S1, tl__hash_r8(p + 8) ^ seed);
+                see1 = tl__hash_mix(tl__hash_r8(p + 16) ^ TL_HASH__S2, tl__hash_r8(p + 24) ^ see1);
+                see2 = tl__hash_mix(tl__hash_r8(p + 32) ^ TL_HASH__S3, tl__hash_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = tl__hash_mix(tl__hash_r8(p) ^ TL_HASH__S1, tl__hash_r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        /* the last 16 bytes, overlapping the previous step if needed */
+        a = tl__hash_r8(p + i - 16);
+        b = tl__hash_r8(p + i - 8);
+    }
+    a ^= TL_HASH__S1;
+    b ^= seed;
+    tl__hash_mum(&a, &b);
+    return tl__hash_mix(a ^ TL_HASH__S0 ^ (u64_t)size, b ^ TL_HASH__S1);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+u64_t
+tl_hash_u64(u64_t x)
+{
+    u64_t a = x ^ TL_HASH__S0;
+    u64_t b = (x >> 32 | x << 32) ^ TL_HASH__S1;
+    tl__hash_mum(&a, &b);
+    return tl__hash_mix(a ^ TL_HASH__S0, b ^ TL_HASH__S1);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+u64_t
+tl_hash_u32(u32_t x)
+{
+    return tl__hash_mix((u64_t)x ^ TL_HASH__S0, ((u64_t)x << 32 | x) ^ TL_HASH__S1);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+u64_t
+tl_hash_bytes(const void *data, size_t size)
+{
+#if defined(TL_HASH_USE_FNV)
+    return tl_hash_fnv1a(data, size);
+#else
+    return tl_hash_wy(data, size, TL_HASH_SEED);
+#endif
+}
+
 TL_ATTR_MAYBE_UNUSED
 static inline
 u64_t
@@ -637,9 +836,21 @@ static inline
 u64_t
 tl_map_hash_bytes_key(const void *key, size_t key_size)
 {
+#if !defined(TL_HASH_USE_FNV)
+    if (key_size == sizeof(u64_t)) return tl_hash_u64(tl__hash_r8((const byte_t *)key));
+    if (key_size == sizeof(u32_t)) return tl_hash_u32((u32_t)tl__hash_r4((const byte_t *)key));
+#endif
     return tl_hash_bytes(key, key_size);
 }
 
+TL_ATTR_MAYBE_UNUSED
+static inline
+u64_t
+tl_map_hash_fnv1a_key(const void *key, size_t key_size)
+{
+    return tl_hash_fnv1a(key, key_size);
+}
+
 TL_ATTR_MAYBE_UNUSED
 static inline
 b32_t
@@ -693,6 +904,143 @@ tl__map_allocator(const TL_Map *map)
     return (map && map->alloc) ? map->alloc : (TL_Allocator *)&tl_default_allocator;
 }
 
+/* Control-byte groups. Masks have bit i set for slot (group start + i). */
+
+static inline
+int
+tl__map_ctz(u32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    int bit = 0;
+    while (!(x & 1U)) {
+        x >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+static inline
+byte_t
+tl__map_h2(u64_t hash)
+{
+    return (byte_t)(hash >> 57);
+}
+
+/* Bits below the lowest set bit of `mask`; every bit when it is 0. */
+static inline
+u32_t
+tl__map_below_first(u32_t mask)
+{
+    return mask ? (mask & (0U - mask)) - 1U : 0xFFFFU;
+}
+
+#if defined(TL_MAP__SSE2)
+
+static inline
+u32_t
+tl__map_group_eq(const byte_t *group, byte_t ctrl)
+{
+    __m128i g = _mm_loadu_si128((const __m128i *)(const void *)group);
+    return (u32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)ctrl)));
+}
+
+static inline u32_t tl__map_group_match(const byte_t *group, byte_t h2) { return tl__map_group_eq(group, h2); }
+
+/* EMPTY is the only control byte with the high bit set */
+static inline
+u32_t
+tl__map_group_empty(const byte_t *group)
+{
+    return (u32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)group));
+}
+
+#else
+
+#define TL__MAP_LSB UINT64_C(0x0101010101010101)
+#define TL__MAP_MSB UINT64_C(0x8080808080808080)
+
+/* Control bytes in slot order, slot 0 in the low byte. */
+static inline
+u64_t
+tl__map_load_word(const byte_t *p)
+{
+    u64_t w;
+    memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+/* High bit of each byte -> one bit per byte. */
+static inline
+u32_t
+tl__map_word_pack(u64_t msb)
+{
+    return (u32_t)(((msb >> 7) * UINT64_C(0x0102040810204080)) >> 56);
+}
+
+/* Full bytes equal to h2. The zero-byte trick can flag a byte next to a
+ * real match; eq() sorts those out, as it does real 7-bit collisions. */
+static inline
+u32_t
+tl__map_word_match(u64_t w, byte_t h2)
+{
+    u64_t x = w ^ (TL__MAP_LSB * h2);
+    return tl__map_word_pack((x - TL__MAP_LSB) & ~x & ~w & TL__MAP_MSB);
+}
+
+/* EMPTY is the only control byte with the high bit set */
+static inline
+u32_t
+tl__map_word_empty(u64_t w)
+{
+    return tl__map_word_pack(w & TL__MAP_MSB);
+}
+
+static inline
+u32_t
+tl__map_group_match(const byte_t *group, byte_t h2)
+{
+    return tl__map_word_match(tl__map_load_word(group), h2) |
+           tl__map_word_match(tl__map_load_word(group + 8), h2) << 8;
+}
+
+static inline
+u32_t
+tl__map_group_empty(const byte_t *group)
+{
+    return tl__map_word_empty(tl__map_load_word(group)) |
+           tl__map_word_empty(tl__map_load_word(group + 8)) << 8;
+}
+
+#endif
+
+static inline
+size_t
+tl__map_ctrl_bytes(size_t cap)
+{
+    return cap + TL_MAP_GROUP - 1U;
+}
+
+static inline
+void
+tl__map_ctrl_store(byte_t *states, size_t cap, size_t idx, byte_t ctrl)
+{
+    states[idx] = ctrl;
+    if (idx < TL_MAP_GROUP - 1U) states[cap + idx] = ctrl;
+}
+
+static inline
+void
+tl__map_set_ctrl(TL_Map *map, size_t idx, byte_t ctrl)
+{
+    tl__map_ctrl_store(map->states, map->cap, idx, ctrl);
+}
+
 static inline
 b32_t
 tl__map_should_grow(size_t used_slots, size_t cap)
@@ -702,7 +1050,6 @@ tl__map_should_grow(size_t used_slots, size_t cap)
 
 typedef enum TL__MapRehashKind {
     TL__MAP_REHASH_NONE = 0,
-    TL__MAP_REHASH_SAME_CAP,
     TL__MAP_REHASH_GROW,
 } TL__MapRehashKind;
 
@@ -729,20 +1076,8 @@ TL__MapRehashDecision
 tl__map_rehash_decision(const TL_Map *map, size_t target_live)
 {
     TL__MapRehashDecision decision = { TL__MAP_REHASH_NONE, map->cap, 1 };
-    size_t used_slots;
 
-    if (map->tombs > SIZE_MAX - target_live) {
-        decision.ok = 0;
-        return decision;
-    }
-
-    used_slots = target_live + map->tombs;
-    if (!tl__map_should_grow(used_slots, map->cap)) return decision;
-
-    if (map->cap != 0 && !tl__map_should_grow(target_live, map->cap)) {
-        decision.kind = TL__MAP_REHASH_SAME_CAP;
-        return decision;
-    }
+    if (!tl__map_should_grow(target_live, map->cap)) return decision;
 
     decision.kind = TL__MAP_REHASH_GROW;
     decision.new_cap = tl__map_next_cap(target_live);
@@ -773,7 +1108,7 @@ tl__map_alloc_arrays(TL_Map *map, size_t cap)
         return 0;
     }
 
-    map->states = (byte_t *)tl_allocator_alloc_aligned(alloc, cap, TL_ALIGNOF(byte_t));
+    map->states = (byte_t *)tl_allocator_alloc_aligned(alloc, tl__map_ctrl_bytes(cap), TL_ALIGNOF(byte_t));
     if (!map->states) {
         tl_allocator_free_aligned(alloc, map->values, values_size, map->value_align);
         tl_allocator_free_aligned(alloc, map->keys, keys_size, map->key_align);
@@ -782,7 +1117,18 @@ tl__map_alloc_arrays(TL_Map *map, size_t cap)
         return 0;
     }
 
-    memset(map->states, TL_MAP_EMPTY, cap);
+    map->dists = (byte_t *)tl_allocator_alloc_aligned(alloc, cap, TL_ALIGNOF(byte_t));
+    if (!map->dists) {
+        tl_allocator_free_aligned(alloc, map->states, tl__map_ctrl_bytes(cap), TL_ALIGNOF(byte_t));
+        tl_allocator_free_aligned(alloc, map->values, values_size, map->value_align);
+        tl_allocator_free_aligned(alloc, map->keys, keys_size, map->key_align);
+        map->keys = NULL;
+        map->values = NULL;
+        map->states = NULL;
+        return 0;
+    }
+
+    memset(map->states, TL_MAP_EMPTY, tl__map_ctrl_bytes(cap));
     map->cap = cap;
     return 1;
 }
@@ -801,31 +1147,44 @@ tl__map_free_arrays(TL_Map *map)
         tl_allocator_free_aligned(alloc, map->values, map->cap * map->value_stride, map->value_align);
     }
     if (map->states) {
-        tl_allocator_free_aligned(alloc, map->states, map->cap, TL_ALIGNOF(byte_t));
+        tl_allocator_free_aligned(alloc, map->states, tl__map_ctrl_bytes(map->cap), TL_ALIGNOF(byte_t));
+    }
+    if (map->dists) {
+        tl_allocator_free_aligned(alloc, map->dists, map->cap, TL_ALIGNOF(byte_t));
     }
     map->keys = NULL;
     map->values = NULL;
     map->states = NULL;
+    map->dists = NULL;
     map->cap = 0;
 }
 
 static inline
 size_t
-tl__map_find_entry(const TL_Map *map, const void *key)
+tl__map_find_entry(const TL_Map *map, const void *key, u64_t hash)
 {
+    size_t mask;
     size_t idx;
-    size_t i;
+    size_t probed;
+    byte_t h2 = tl__map_h2(hash);
 
     if (map->cap == 0) return SIZE_MAX;
 
-    idx = (size_t)(map->hash(key, map->key_size) & (u64_t)(map->cap - 1U));
-    for (i = 0; i < map->cap; ++i) {
-        byte_t state = map->states[idx];
-        if (state == TL_MAP_EMPTY) return SIZE_MAX;
-        if (state == TL_MAP_FULL && map->eq(tl__map_key_at(map, idx), key, map->key_size)) {
-            return idx;
+    mask = map->cap - 1U;
+    idx = (size_t)(hash & (u64_t)mask);
+    for (probed = 0; probed < map->cap; probed += TL_MAP_GROUP) {
+        const byte_t *group = map->states + idx;
+        u32_t empty = tl__map_group_empty(group);
+        /* a key never sits past the first empty slot of its probe run */
+        u32_t match = tl__map_group_match(group, h2) & tl__map_below_first(empty);
+
+        while (match) {
+            size_t slot = (idx + (size_t)tl__map_ctz(match)) & mask;
+            if (map->eq(tl__map_key_at(map, slot), key, map->key_size)) return slot;
+            match &= match - 1U;
         }
-        idx = (idx + 1U) & (map->cap - 1U);
+        if (empty) return SIZE_MAX;
+        idx = (idx + TL_MAP_GROUP) & mask;
     }
 
     return SIZE_MAX;
@@ -833,45 +1192,191 @@ tl__map_find_entry(const TL_Map *map, const void *key)
 
 static inline
 size_t
-tl__map_find_insert_slot(const TL_Map *map, const void *key)
+tl__map_dist(const TL_Map *map, size_t idx)
 {
-    size_t idx;
-    size_t first_tomb = SIZE_MAX;
-    size_t i;
+    byte_t d = map->dists[idx];
 
-    if (map->cap == 0) return SIZE_MAX;
+    if (d != TL_MAP_DIST_SAT) return d;
+    return (idx - (size_t)map->hash(tl__map_key_at(map, idx), map->key_size)) & (map->cap - 1U);
+}
 
-    idx = (size_t)(map->hash(key, map->key_size) & (u64_t)(map->cap - 1U));
-    for (i = 0; i < map->cap; ++i) {
-        byte_t state = map->states[idx];
-        if (state == TL_MAP_EMPTY) {
-            return first_tomb != SIZE_MAX ? first_tomb : idx;
-        }
-        if (state == TL_MAP_TOMB) {
-            if (first_tomb == SIZE_MAX) first_tomb = idx;
-        } else if (map->eq(tl__map_key_at(map, idx), key, map->key_size)) {
-            return idx;
+static inline
+void
+tl__map_dist_store(byte_t *dists, size_t idx, size_t dist)
+{
+    dists[idx] = dist < TL_MAP_DIST_SAT ? (byte_t)dist : (byte_t)TL_MAP_DIST_SAT;
+}
+
+static inline
+void
+tl__map_set_dist(TL_Map *map, size_t idx, size_t dist)
+{
+    tl__map_dist_store(map->dists, idx, dist);
+}
+
+/* Moves the entry at src to the empty slot dst, one slot away. */
+static inline
+void
+tl__map_move_slot(TL_Map *map, size_t dst, size_t src)
+{
+    size_t dist = tl__map_dist(map, src);
+
+    memcpy(tl__map_key_at(map, dst), tl__map_key_at(map, src), map->key_size);
+    memcpy(tl__map_value_at(map, dst), tl__map_value_at(map, src), map->value_size);
+    tl__map_set_ctrl(map, dst, map->states[src]);
+    /* dst is src + 1 when shifting right, src - 1 when shifting back */
+    tl__map_set_dist(map, dst, dst == ((src + 1U) & (map->cap - 1U)) ? dist + 1U : dist - 1U);
+}
+
+/* Robin Hood insert of a key that is not in the map; needs a free slot. */
+static inline
+void
+tl__map_insert_new(TL_Map *map, const void *key, const void *value, u64_t hash)
+{
+    size_t mask = map->cap - 1U;
+    size_t idx = (size_t)(hash & (u64_t)mask);
+    size_t dist = 0;
+    size_t end;
+
+    while (TL_MAP_IS_FULL(map->states[idx]) && tl__map_dist(map, idx) >= dist) {
+        idx = (idx + 1U) & mask;
+        ++dist;
+    }
+
+    /* make room: shift the rest of the run one slot right, last entry first */
+    for (end = idx; TL_MAP_IS_FULL(map->states[end]); end = (end + 1U) & mask) {}
+    while (end != idx) {
+        size_t prev = (end - 1U) & mask;
+        tl__map_move_slot(map, end, prev);
+        end = prev;
+    }
+
+    tl__map_set_ctrl(map, idx, tl__map_h2(hash));
+    tl__map_set_dist(map, idx, dist);
+    memcpy(tl__map_key_at(map, idx), key, map->key_size);
+    memcpy(tl__map_value_at(map, idx), value, map->value_size);
+    map->len++;
+}
+
+/* Empties idx and pulls the rest of its run back by one slot. */
+static inline
+void
+tl__map_erase_at(TL_Map *map, size_t idx)
+{
+    size_t mask = map->cap - 1U;
+    size_t next = (idx + 1U) & mask;
+
+    while (TL_MAP_IS_FULL(map->states[next]) && map->dists[next] != 0) {
+        tl__map_move_slot(map, idx, next);
+        idx = next;
+        next = (next + 1U) & mask;
+    }
+    tl__map_set_ctrl(map, idx, TL_MAP_EMPTY);
+    map->len--;
+}
+
+static inline
+size_t
+tl__map_total_len(const TL_Map *map)
+{
+    return map->len + (map->old ? map->old->len : 0U);
+}
+
+/* Value slot of key in the new table or the one being migrated from. */
+static inline
+byte_t *
+tl__map_find_value(const TL_Map *map, const void *key, u64_t hash)
+{
+    size_t idx = tl__map_find_entry(map, key, hash);
+
+    if (idx != SIZE_MAX) return tl__map_value_at(map, idx);
+    if (map->old) {
+        idx = tl__map_find_entry(map->old, key, hash);
+        if (idx != SIZE_MAX) return tl__map_value_at(map->old, idx);
+    }
+    return NULL;
+}
+
+/* Moves up to `budget` old slots into the new table, and drops the old
+ * table once it is empty. */
+static inline
+void
+tl__map_migrate(TL_Map *map, size_t budget)
+{
+    TL_Map *old = map->old;
+
+    if (!old) return;
+    while (budget && old->len != 0) {
+        size_t i = map->migrate_pos;
+
+        if (TL_MAP_IS_FULL(old->states[i])) {
+            byte_t *key = tl__map_key_at(old, i);
+            tl__map_insert_new(map, key, tl__map_value_at(old, i), old->hash(key, old->key_size));
+            /* pulls the rest of the run back into i, which is looked at again */
+            tl__map_erase_at(old, i);
+        } else {
+            map->migrate_pos++;
         }
-        idx = (idx + 1U) & (map->cap - 1U);
+        --budget;
+    }
+    if (old->len == 0) {
+        tl__map_free_arrays(old);
+        tl_allocator_free(tl__map_allocator(map), old, sizeof(*old));
+        map->old = NULL;
+        map->migrate_pos = 0;
     }
+}
 
-    return first_tomb;
+/* Slots to migrate on this put, get_mut or remove: the configured step, or
+ * more when that would leave old entries behind at the next grow. What is
+ * left costs at most one visit per old slot not yet passed plus one per old
+ * entry (a moved slot is looked at again), and spreading it over the puts
+ * that can still happen before the new table grows means that grow never
+ * has to finish a migration. */
+static inline
+size_t
+tl__map_migrate_budget(const TL_Map *map)
+{
+    size_t limit;
+    size_t total;
+    size_t left;
+    size_t work;
+
+    if (!map->old) return map->rehash_step;
+    limit = map->cap - map->cap / 4U;
+    total = tl__map_total_len(map);
+    /* the put that takes total to limit grows, so finish before it */
+    if (total + 1U >= limit) return SIZE_MAX;
+
+    left = limit - total - 1U;
+    work = map->old->len + (map->old->cap - map->migrate_pos);
+    return TL_MAX(map->rehash_step, (work + left - 1U) / left);
 }
 
+/* Moves the current table aside as `old` and gives the map an empty one of
+ * new_cap slots; tl__map_migrate() does the rest. */
 static inline
 b32_t
-tl__map_insert_no_grow(TL_Map *map, const void *key, const void *value)
+tl__map_rehash_start(TL_Map *map, size_t new_cap)
 {
-    size_t idx = tl__map_find_insert_slot(map, key);
+    TL_Allocator *alloc = tl__map_allocator(map);
+    TL_Map *old = (TL_Map *)tl_allocator_alloc(alloc, sizeof(*old));
 
-    if (idx == SIZE_MAX) return 0;
-    if (map->states[idx] != TL_MAP_FULL) {
-        if (map->states[idx] == TL_MAP_TOMB) map->tombs--;
-        map->states[idx] = TL_MAP_FULL;
-        map->len++;
-        memcpy(tl__map_key_at(map, idx), key, map->key_size);
+    if (!old) return 0;
+    *old = *map;
+    map->len = 0;
+    map->cap = 0;
+    map->keys = NULL;
+    map->values = NULL;
+    map->states = NULL;
+    map->dists = NULL;
+    if (!tl__map_alloc_arrays(map, new_cap)) {
+        *map = *old;
+        tl_allocator_free(alloc, old, sizeof(*old));
+        return 0;
     }
-    memcpy(tl__map_value_at(map, idx), value, map->value_size);
+    map->old = old;
+    map->migrate_pos = 0;
     return 1;
 }
 
@@ -879,28 +1384,36 @@ static inline
 b32_t
 tl__map_rehash(TL_Map *map, size_t new_cap)
 {
-    TL_Map next = *map;
-    byte_t *old_keys = map->keys;
-    byte_t *old_values = map->values;
-    byte_t *old_states = map->states;
-    size_t old_cap = map->cap;
+    TL_Map next;
+    byte_t *old_keys;
+    byte_t *old_values;
+    byte_t *old_states;
+    size_t old_cap;
     size_t i;
 
+    /* finishing a migration may free map->old, so snapshot after it */
+    tl__map_migrate(map, SIZE_MAX);
+    if (map->rehash_step && map->len) return tl__map_rehash_start(map, new_cap);
+
+    next = *map;
+    old_keys = map->keys;
+    old_values = map->values;
+    old_states = map->states;
+    old_cap = map->cap;
+
     next.len = 0;
     next.cap = 0;
-    next.tombs = 0;
     next.keys = NULL;
     next.values = NULL;
     next.states = NULL;
+    next.dists = NULL;
     if (!tl__map_alloc_arrays(&next, new_cap)) return 0;
 
     for (i = 0; i < old_cap; ++i) {
-        if (old_states[i] == TL_MAP_FULL &&
-            !tl__map_insert_no_grow(&next,
-                                    old_keys + i * map->key_stride,
-                                    old_values + i * map->value_stride)) {
-            tl__map_free_arrays(&next);
-            return 0;
+        const byte_t *key = old_keys + i * map->key_stride;
+
+        if (TL_MAP_IS_FULL(old_states[i])) {
+            tl__map_insert_new(&next, key, old_values + i * map->value_stride, map->hash(key, map->key_size));
         }
     }
 
@@ -922,7 +1435,6 @@ tl__map_apply_rehash_decision(TL_Map *map, TL__MapRehashDecision decision)
     switch (decision.kind) {
     case TL__MAP_REHASH_NONE:
         return 1;
-    case TL__MAP_REHASH_SAME_CAP:
     case TL__MAP_REHASH_GROW:
         return tl__map_rehash(map, decision.new_cap);
     default:
@@ -956,7 +1468,6 @@ tl_map_init_impl(TL_Map *map,
 
     map->len = 0;
     map->cap = 0;
-    map->tombs = 0;
     map->key_size = key_size;
     map->key_align = key_align;
     map->key_stride = key_stride;
@@ -969,6 +1480,10 @@ tl_map_init_impl(TL_Map *map,
     map->keys = NULL;
     map->values = NULL;
     map->states = NULL;
+    map->dists = NULL;
+    map->old = NULL;
+    map->migrate_pos = 0;
+    map->rehash_step = 0;
     return 1;
 }
 
@@ -978,9 +1493,14 @@ void
 tl_map_free_impl(TL_Map *map)
 {
     if (!map) return;
+    if (map->old) {
+        tl__map_free_arrays(map->old);
+        tl_allocator_free(tl__map_allocator(map), map->old, sizeof(*map->old));
+        map->old = NULL;
+        map->migrate_pos = 0;
+    }
     tl__map_free_arrays(map);
     map->len = 0;
-    map->tombs = 0;
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -991,7 +1511,7 @@ tl_map_reserve_impl(TL_Map *map, size_t need_len)
     TL__MapRehashDecision decision;
 
     assert(map != NULL);
-    if (need_len <= map->len) return 1;
+    if (need_len <= tl__map_total_len(map)) return 1;
 
     decision = tl__map_rehash_decision(map, need_len);
     return tl__map_apply_rehash_decision(map, decision);
@@ -1008,7 +1528,9 @@ tl_map_put_impl(TL_Map *map,
                 size_t value_size,
                 size_t value_align)
 {
-    size_t idx;
+    byte_t *slot;
+    size_t total;
+    u64_t hash;
     TL__MapRehashDecision decision;
 
     assert(map != NULL);
@@ -1019,17 +1541,21 @@ tl_map_put_impl(TL_Map *map,
     TL_DS_ASSERT(map->key_align == tl_normalize_align(key_align), "map key alignment mismatch");
     TL_DS_ASSERT(map->value_align == tl_normalize_align(value_align), "map value alignment mismatch");
 
-    idx = tl__map_find_entry(map, key);
-    if (idx != SIZE_MAX) {
-        memcpy(tl__map_value_at(map, idx), value, map->value_size);
+    tl__map_migrate(map, tl__map_migrate_budget(map));
+    hash = map->hash(key, map->key_size);
+    slot = tl__map_find_value(map, key, hash);
+    if (slot) {
+        memcpy(slot, value, map->value_size);
         return 1;
     }
 
-    if (map->len == SIZE_MAX) return 0;
-    decision = tl__map_rehash_decision(map, map->len + 1U);
+    total = tl__map_total_len(map);
+    if (total == SIZE_MAX) return 0;
+    decision = tl__map_rehash_decision(map, total + 1U);
     if (!tl__map_apply_rehash_decision(map, decision)) return 0;
 
-    return tl__map_insert_no_grow(map, key, value);
+    tl__map_insert_new(map, key, value, hash);
+    return 1;
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -1037,16 +1563,13 @@ static inline
 const void *
 tl_map_get_const_impl(const TL_Map *map, const void *key, size_t key_size, size_t key_align)
 {
-    size_t idx;
-
     assert(map != NULL);
     if (!map->cap) return NULL;
     TL_DS_ASSERT(key != NULL, "map key must not be NULL");
     TL_DS_ASSERT(map->key_size == key_size, "map key size mismatch");
     TL_DS_ASSERT(map->key_align == tl_normalize_align(key_align), "map key alignment mismatch");
 
-    idx = tl__map_find_entry(map, key);
-    return idx != SIZE_MAX ? tl__map_value_at(map, idx) : NULL;
+    return tl__map_find_value(map, key, map->hash(key, map->key_size));
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -1054,16 +1577,14 @@ static inline
 void *
 tl_map_get_mut_impl(TL_Map *map, const void *key, size_t key_size, size_t key_align)
 {
-    size_t idx;
-
     assert(map != NULL);
     if (!map->cap) return NULL;
     TL_DS_ASSERT(key != NULL, "map key must not be NULL");
     TL_DS_ASSERT(map->key_size == key_size, "map key size mismatch");
     TL_DS_ASSERT(map->key_align == tl_normalize_align(key_align), "map key alignment mismatch");
 
-    idx = tl__map_find_entry(map, key);
-    return idx != SIZE_MAX ? tl__map_value_at(map, idx) : NULL;
+    tl__map_migrate(map, tl__map_migrate_budget(map));
+    return tl__map_find_value(map, key, map->hash(key, map->key_size));
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -1096,6 +1617,7 @@ b32_t
 tl_map_remove_impl(TL_Map *map, const void *key, size_t key_size, size_t key_align)
 {
     size_t idx;
+    u64_t hash;
 
     assert(map != NULL);
     if (!map->cap) return 0;
@@ -1103,17 +1625,107 @@ tl_map_remove_impl(TL_Map *map, const void *key, size_t key_size, size_t key_ali
     TL_DS_ASSERT(map->key_size == key_size, "map key size mismatch");
     TL_DS_ASSERT(map->key_align == tl_normalize_align(key_align), "map key alignment mismatch");
 
-    idx = tl__map_find_entry(map, key);
-    if (idx == SIZE_MAX) return 0;
-    map->states[idx] = TL_MAP_TOMB;
-    map->len--;
-    map->tombs++;
-    return 1;
+    tl__map_migrate(map, tl__map_migrate_budget(map));
+    hash = map->hash(key, map->key_size);
+    idx = tl__map_find_entry(map, key, hash);
+    if (idx != SIZE_MAX) {
+        tl__map_erase_at(map, idx);
+        return 1;
+    }
+    if (map->old) {
+        idx = tl__map_find_entry(map->old, key, hash);
+        if (idx != SIZE_MAX) {
+            tl__map_erase_at(map->old, idx);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Turns incremental rehashing on, moving `step` old slots per put, get_mut
+ * and remove, or off with 0, which finishes a running migration first.
+ * There is no minimum: below 3 the map moves what it must on its own so
+ * the migration still ends before the next grow. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_map_set_incremental_impl(TL_Map *map, size_t step)
+{
+    assert(map != NULL);
+    map->rehash_step = step;
+    if (!step) tl__map_migrate(map, SIZE_MAX);
 }
 
-#define tl_map_len(map) ((map).len)
+/* Moves up to `budget` old slots across. Returns 1 while a migration is
+ * still running. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_map_rehash_step_impl(TL_Map *map, size_t budget)
+{
+    assert(map != NULL);
+    tl__map_migrate(map, budget);
+    return map->old != NULL;
+}
+
+static inline
+size_t
+tl__map_probe_accum(const TL_Map *table, TL_MapProbeStats *stats)
+{
+    size_t total = 0;
+    size_t i;
+
+    for (i = 0; i < table->cap; ++i) {
+        size_t dist;
+        int bucket = 0;
+
+        if (!TL_MAP_IS_FULL(table->states[i])) continue;
+        dist = tl__map_dist(table, i);
+        while (bucket < TL_MAP_PROBE_BUCKETS - 1 && dist >= ((size_t)1 << bucket)) ++bucket;
+        ++stats->hist[bucket];
+        stats->max = TL_MAX(stats->max, dist);
+        total += dist;
+    }
+    return total;
+}
+
+/* Distance of every entry from its home slot, over both tables while
+ * migrating. Walks the whole map. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_MapProbeStats
+tl_map_probe_stats_impl(const TL_Map *map)
+{
+    TL_MapProbeStats stats;
+    size_t total;
+
+    assert(map != NULL);
+    memset(&stats, 0, sizeof(stats));
+    stats.len = tl__map_total_len(map);
+    stats.cap = map->cap;
+    total = tl__map_probe_accum(map, &stats);
+    if (map->old) total += tl__map_probe_accum(map->old, &stats);
+    stats.mean = stats.len ? (double)total / (double)stats.len : 0.0;
+    return stats;
+}
+
+#define tl_map_len(map) tl__map_total_len(&(map))
 #define tl_map_cap(map) ((map).cap)
 #define tl_map_empty(map) (tl_map_len(map) == 0U)
+#define tl_map_probe_stats(map) tl_map_probe_stats_impl(&(map))
+#define tl_map_rehashing(map) ((map).old != NULL)
+
+#define tl_map_set_incremental(map, step) \
+    do { \
+        TL_REQUIRE_LVALUE(map); \
+        tl_map_set_incremental_impl(&(map), (size_t)(step)); \
+    } while (0)
+
+#define tl_map_rehash_step(map, budget) \
+    TL_DS__EXPR( \
+        TL_REQUIRE_LVALUE(map); \
+        tl_map_rehash_step_impl(&(map), (size_t)(budget)); \
+    )
 
 /* Bytewise maps hash and compare the object representation of each key.
  * This is a good default for scalar keys and fully initialized POD-like keys.
@@ -1267,6 +1879,269 @@ tl_map_remove_impl(TL_Map *map, const void *key, size_t key_size, size_t key_ali
         tl_map_try_get_impl(&(map), &tl__key, sizeof(tl__key), TL_ALIGNOF(tl__key), tl__out, sizeof(*tl__out), TL_ALIGNOF(*tl__out)); \
     )
 
+/* -------------------------------------------------------------------------- */
+/* Typed hash map                                                             */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * TL_DEFINE_MAP(Name, K, V, HASH, EQ) defines a map type `Name` from K to V
+ * with the same layout rules as TL_Map (7-bit control bytes probed a group at
+ * a time, Robin Hood inserts, backward-shift removes), but with HASH and EQ
+ * expanded inline and each key stored next to its value in one `Name##Slot`,
+ * so a hit touches one cache line instead of two. HASH(const K *) returns
+ * u64_t; EQ(const K *, const K *) returns nonzero when equal. Either may be
+ * a function or a function-like macro, such as the TL_MAP_HASH_* and
+ * TL_MAP_EQ_* helpers below. Use TL_Map when key/value types are only known
+ * at run time or for incremental rehashing.
+ *
+ *   TL_DEFINE_MAP(IdMap, u64_t, u32_t, TL_MAP_HASH_U64, TL_MAP_EQ_SCALAR)
+ *
+ *   IdMap ids;
+ *   IdMap_init(&ids, NULL);
+ *   IdMap_put(&ids, 42, 7);
+ *   const u32_t *v = IdMap_get_const(&ids, 42);
+ *   IdMap_free(&ids);
+ */
+#define TL_MAP_HASH_U32(key) tl_hash_u32(*(key))
+#define TL_MAP_HASH_U64(key) tl_hash_u64(*(key))
+#define TL_MAP_HASH_BYTES(key) tl_hash_bytes((key), sizeof(*(key)))
+#define TL_MAP_HASH_STRVIEW(key) tl_map_hash_strview_key((key), sizeof(TL_StrView))
+#define TL_MAP_EQ_SCALAR(a, b) (*(a) == *(b))
+#define TL_MAP_EQ_BYTES(a, b) (memcmp((a), (b), sizeof(*(a))) == 0)
+#define TL_MAP_EQ_STRVIEW(a, b) tl_map_eq_strview_key((a), (b), sizeof(TL_StrView))
+
+#define TL_DEFINE_MAP(Name, K, V, HASH, EQ) \
+    typedef struct Name##Slot { \
+        K key; \
+        V value; \
+    } Name##Slot; \
+    \
+    typedef struct Name { \
+        size_t len; \
+        size_t cap; \
+        TL_Allocator *alloc; \
+        Name##Slot *slots; \
+        byte_t *states; \
+        byte_t *dists; \
+    } Name; \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    void \
+    Name##_init(Name *map, TL_Allocator *alloc) \
+    { \
+        memset(map, 0, sizeof(*map)); \
+        map->alloc = alloc ? alloc : (TL_Allocator *)&tl_default_allocator; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    void \
+    Name##_free(Name *map) \
+    { \
+        if (map->cap) { \
+            tl_allocator_free_aligned(map->alloc, map->slots, map->cap * sizeof(Name##Slot), TL_ALIGNOF(Name##Slot)); \
+            tl_allocator_free_aligned(map->alloc, map->states, tl__map_ctrl_bytes(map->cap), TL_ALIGNOF(byte_t)); \
+            tl_allocator_free_aligned(map->alloc, map->dists, map->cap, TL_ALIGNOF(byte_t)); \
+        } \
+        map->slots = NULL; \
+        map->states = NULL; \
+        map->dists = NULL; \
+        map->len = 0; \
+        map->cap = 0; \
+    } \
+    \
+    static inline \
+    size_t \
+    Name##__dist(const Name *map, size_t idx) \
+    { \
+        byte_t d = map->dists[idx]; \
+        if (d != TL_MAP_DIST_SAT) return d; \
+        return (idx - (size_t)HASH(&map->slots[idx].key)) & (map->cap - 1U); \
+    } \
+    \
+    static inline \
+    size_t \
+    Name##__find(const Name *map, const K *key, u64_t hash) \
+    { \
+        size_t mask; \
+        size_t idx; \
+        size_t probed; \
+        byte_t h2 = tl__map_h2(hash); \
+        \
+        if (map->cap == 0) return SIZE_MAX; \
+        mask = map->cap - 1U; \
+        idx = (size_t)(hash & (u64_t)mask); \
+        for (probed = 0; probed < map->cap; probed += TL_MAP_GROUP) { \
+            const byte_t *group = map->states + idx; \
+            u32_t empty = tl__map_group_empty(group); \
+            u32_t match = tl__map_group_match(group, h2) & tl__map_below_first(empty); \
+            while (match) { \
+                size_t slot = (idx + (size_t)tl__map_ctz(match)) & mask; \
+                if (EQ(&map->slots[slot].key, key)) return slot; \
+                match &= match - 1U; \
+            } \
+            if (empty) return SIZE_MAX; \
+            idx = (idx + TL_MAP_GROUP) & mask; \
+        } \
+        return SIZE_MAX; \
+    } \
+    \
+    static inline \
+    void \
+    Name##__insert_new(Name *map, const Name##Slot *entry, u64_t hash) \
+    { \
+        size_t mask = map->cap - 1U; \
+        size_t idx = (size_t)(hash & (u64_t)mask); \
+        size_t dist = 0; \
+        size_t end; \
+        \
+        while (TL_MAP_IS_FULL(map->states[idx]) && Name##__dist(map, idx) >= dist) { \
+            idx = (idx + 1U) & mask; \
+            ++dist; \
+        } \
+        for (end = idx; TL_MAP_IS_FULL(map->states[end]); end = (end + 1U) & mask) {} \
+        while (end != idx) { \
+            size_t prev = (end - 1U) & mask; \
+            map->slots[end] = map->slots[prev]; \
+            tl__map_ctrl_store(map->states, map->cap, end, map->states[prev]); \
+            tl__map_dist_store(map->dists, end, Name##__dist(map, prev) + 1U); \
+            end = prev; \
+        } \
+        map->slots[idx] = *entry; \
+        tl__map_ctrl_store(map->states, map->cap, idx, tl__map_h2(hash)); \
+        tl__map_dist_store(map->dists, idx, dist); \
+        map->len++; \
+    } \
+    \
+    static inline \
+    void \
+    Name##__erase_at(Name *map, size_t idx) \
+    { \
+        size_t mask = map->cap - 1U; \
+        size_t next = (idx + 1U) & mask; \
+        \
+        while (TL_MAP_IS_FULL(map->states[next]) && map->dists[next] != 0) { \
+            map->slots[idx] = map->slots[next]; \
+            tl__map_ctrl_store(map->states, map->cap, idx, map->states[next]); \
+            tl__map_dist_store(map->dists, idx, Name##__dist(map, next) - 1U); \
+            idx = next; \
+            next = (next + 1U) & mask; \
+        } \
+        tl__map_ctrl_store(map->states, map->cap, idx, TL_MAP_EMPTY); \
+        map->len--; \
+    } \
+    \
+    static inline \
+    b32_t \
+    Name##__rehash(Name *map, size_t new_cap) \
+    { \
+        Name next = *map; \
+        size_t i; \
+        \
+        if (new_cap > SIZE_MAX / sizeof(Name##Slot)) return 0; \
+        next.len = 0; \
+        next.cap = new_cap; \
+        next.slots = (Name##Slot *)tl_allocator_alloc_aligned(map->alloc, new_cap * sizeof(Name##Slot), TL_ALIGNOF(Name##Slot)); \
+        next.states = (byte_t *)tl_allocator_alloc_aligned(map->alloc, tl__map_ctrl_bytes(new_cap), TL_ALIGNOF(byte_t)); \
+        next.dists = (byte_t *)tl_allocator_alloc_aligned(map->alloc, new_cap, TL_ALIGNOF(byte_t)); \
+        if (!next.slots || !next.states || !next.dists) { \
+            if (next.slots) tl_allocator_free_aligned(map->alloc, next.slots, new_cap * sizeof(Name##Slot), TL_ALIGNOF(Name##Slot)); \
+            if (next.states) tl_allocator_free_aligned(map->alloc, next.states, tl__map_ctrl_bytes(new_cap), TL_ALIGNOF(byte_t)); \
+            if (next.dists) tl_allocator_free_aligned(map->alloc, next.dists, new_cap, TL_ALIGNOF(byte_t)); \
+            return 0; \
+        } \
+        memset(next.states, TL_MAP_EMPTY, tl__map_ctrl_bytes(new_cap)); \
+        for (i = 0; i < map->cap; ++i) { \
+            if (TL_MAP_IS_FULL(map->states[i])) { \
+                Name##__insert_new(&next, &map->slots[i], HASH(&map->slots[i].key)); \
+            } \
+        } \
+        Name##_free(map); \
+        *map = next; \
+        return 1; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    b32_t \
+    Name##_reserve(Name *map, size_t need_len) \
+    { \
+        size_t cap; \
+        \
+        if (!tl__map_should_grow(need_len, map->cap)) return 1; \
+        cap = tl__map_next_cap(need_len); \
+        return cap != 0 && Name##__rehash(map, cap); \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    b32_t \
+    Name##_put(Name *map, K key, V value) \
+    { \
+        Name##Slot entry; \
+        u64_t hash = HASH(&key); \
+        size_t idx = Name##__find(map, &key, hash); \
+        \
+        if (idx != SIZE_MAX) { \
+            map->slots[idx].value = value; \
+            return 1; \
+        } \
+        if (map->len == SIZE_MAX || !Name##_reserve(map, map->len + 1U)) return 0; \
+        entry.key = key; \
+        entry.value = value; \
+        Name##__insert_new(map, &entry, hash); \
+        return 1; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    const V * \
+    Name##_get_const(const Name *map, K key) \
+    { \
+        size_t idx = Name##__find(map, &key, HASH(&key)); \
+        return idx != SIZE_MAX ? &map->slots[idx].value : NULL; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    V * \
+    Name##_get_mut(Name *map, K key) \
+    { \
+        size_t idx = Name##__find(map, &key, HASH(&key)); \
+        return idx != SIZE_MAX ? &map->slots[idx].value : NULL; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    b32_t \
+    Name##_try_get(const Name *map, K key, V *out) \
+    { \
+        const V *value = Name##_get_const(map, key); \
+        if (!value) return 0; \
+        *out = *value; \
+        return 1; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    b32_t \
+    Name##_contains(const Name *map, K key) \
+    { \
+        return Name##__find(map, &key, HASH(&key)) != SIZE_MAX; \
+    } \
+    \
+    TL_ATTR_MAYBE_UNUSED \
+    static inline \
+    b32_t \
+    Name##_remove(Name *map, K key) \
+    { \
+        size_t idx = Name##__find(map, &key, HASH(&key)); \
+        if (idx == SIZE_MAX) return 0; \
+        Name##__erase_at(map, idx); \
+        return 1; \
+    }
+
 #if defined(TL_DS_SHORT_NAMES) || defined(TL_SHORT_NAMES)
 /* Optional short aliases. */
 #define ArrBool        TL_ArrBool
@@ -1329,6 +2204,10 @@ tl_map_remove_impl(TL_Map *map, const void *key, size_t key_size, size_t key_ali
 #define map_len        tl_map_len
 #define map_cap        tl_map_cap
 #define map_empty      tl_map_empty
+#define map_probe_stats tl_map_probe_stats
+#define map_rehashing  tl_map_rehashing
+#define map_set_incremental tl_map_set_incremental
+#define map_rehash_step tl_map_rehash_step
 #define map_init_bytewise tl_map_init_bytewise
 #define map_init_ex    tl_map_init_ex
 #define map_init_strview tl_map_init_strview
@@ -7,8 +7,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(MAP_ANONYMOUS)
+#define TL_MEM__HAS_MMAP 1
+#endif
+#endif
+
 #include "defs.h"
 #include "c_ext.h"
+#include "logging.h"
 
 #define TL_MEM_ALIGN TL_ALIGNOF(max_align_t)
 
@@ -68,6 +77,16 @@ typedef struct TL_AllocatorVTable {
                      size_t old_size,
                      size_t new_size,
                      size_t align);
+    /* optional: alloc/realloc given the caller's file:line, used by
+     * TL_ALLOC/TL_REALLOC. NULL falls back to alloc/realloc. */
+    void *(*alloc_at)(void *ctx, size_t size, size_t align, const char *file, int line);
+    void *(*realloc_at)(void *ctx,
+                        void *ptr,
+                        size_t old_size,
+                        size_t new_size,
+                        size_t align,
+                        const char *file,
+                        int line);
 } TL_AllocatorVTable;
 
 typedef struct TL_Allocator {
@@ -223,9 +242,20 @@ static const TL_AllocatorVTable tl_allocatorvt_std = {
     .realloc = tl_allocator_std_realloc,
 };
 
-/* arena allocator */
+/* arena allocator
+ *
+ * Chunks form a list from oldest to newest; allocations only bump `current`,
+ * the newest chunk, so the cost does not depend on how many chunks exist.
+ * Chunk capacity doubles from min_chunk_cap up to max_chunk_cap; larger
+ * requests get a chunk of their own size. Chunks released by
+ * tl_arena_restore()/tl_arena_reset() go to a free list and are reused
+ * before asking malloc again; only tl_arena_destroy() returns them.
+ *
+ * A zero-initialized TL_Arena is valid and uses the default capacities.
+ */
 
-#define TL_ARENA_INITIAL_CAP 4096
+#define TL_ARENA_INITIAL_CAP   4096
+#define TL_ARENA_MAX_CHUNK_CAP ((size_t)1 << 20)
 
 typedef struct TL_ArenaChunk {
     byte_t *data;
@@ -236,6 +266,10 @@ typedef struct TL_ArenaChunk {
 
 typedef struct TL_Arena {
     TL_ArenaChunk *chunks;
+    TL_ArenaChunk *current;
+    TL_ArenaChunk *free_chunks;
+    size_t min_chunk_cap;
+    size_t max_chunk_cap;
 } TL_Arena;
 
 typedef struct TL_ArenaMark {
@@ -243,32 +277,100 @@ typedef struct TL_ArenaMark {
     size_t used;
 } TL_ArenaMark;
 
+/*
+ * Optional: a zero-initialized arena behaves like
+ * tl_arena_init(arena, TL_ARENA_INITIAL_CAP, TL_ARENA_MAX_CHUNK_CAP).
+ * Pass equal capacities to disable growth.
+ */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_arena_init(TL_Arena *arena, size_t min_chunk_cap, size_t max_chunk_cap)
+{
+    assert(arena != NULL);
+    if (min_chunk_cap == 0) min_chunk_cap = TL_ARENA_INITIAL_CAP;
+    if (max_chunk_cap < min_chunk_cap) max_chunk_cap = min_chunk_cap;
+
+    *arena = (TL_Arena){
+        .min_chunk_cap = min_chunk_cap,
+        .max_chunk_cap = max_chunk_cap,
+    };
+}
+
+/* header and data share one allocation */
 static inline
 TL_ArenaChunk *
-tl_arena__add_chunk(size_t cap)
+tl_arena__new_chunk(size_t cap)
 {
-    TL_ArenaChunk *next = (TL_ArenaChunk *)malloc(sizeof(TL_ArenaChunk));
-    if (!next) return NULL;
+    TL_ArenaChunk *chunk;
 
-    next->data = (byte_t *)malloc(cap);
-    if (!next->data) {
-        free(next);
-        return NULL;
-    }
+    if (cap > SIZE_MAX - sizeof(TL_ArenaChunk)) return NULL;
+    chunk = (TL_ArenaChunk *)malloc(sizeof(TL_ArenaChunk) + cap);
+    if (!chunk) return NULL;
 
-    next->used = 0;
-    next->cap = cap;
-    next->next = NULL;
-    return next;
+    chunk->data = (byte_t *)(chunk + 1);
+    chunk->used = 0;
+    chunk->cap = cap;
+    chunk->next = NULL;
+    return chunk;
+}
+
+/* Bump `size` bytes at `align` out of `chunk`, or NULL when it does not fit. */
+static inline
+void *
+tl_arena__bump(TL_ArenaChunk *chunk, size_t size, size_t align)
+{
+    uintptr_t current;
+    uintptr_t aligned;
+    size_t end_used;
+
+    current = (uintptr_t)chunk->data + chunk->used;
+    aligned = tl_align_up_ptr(current, align);
+    if (aligned == 0 || aligned < (uintptr_t)chunk->data) return NULL;
+
+    end_used = (size_t)(aligned - (uintptr_t)chunk->data);
+    if (end_used > chunk->cap || size > chunk->cap - end_used) return NULL;
+
+    chunk->used = end_used + size;
+    return (void *)aligned;
 }
 
+/*
+ * Append a chunk with room for `needed` bytes and make it current: the head
+ * of the free list when it is big enough, otherwise a fresh one that doubles
+ * the previous capacity.
+ */
 static inline
 TL_ArenaChunk *
-tl_arena__last_chunk(TL_Arena *arena)
+tl_arena__grow(TL_Arena *arena, size_t needed)
 {
-    TL_ArenaChunk *chunk = arena->chunks;
-    if (!chunk) return NULL;
-    while (chunk->next) chunk = chunk->next;
+    TL_ArenaChunk *chunk = arena->free_chunks;
+    size_t min_cap = arena->min_chunk_cap ? arena->min_chunk_cap : TL_ARENA_INITIAL_CAP;
+    size_t max_cap = arena->max_chunk_cap ? arena->max_chunk_cap : TL_ARENA_MAX_CHUNK_CAP;
+    size_t cap;
+
+    if (chunk && chunk->cap >= needed) {
+        arena->free_chunks = chunk->next;
+        chunk->next = NULL;
+        chunk->used = 0;
+    } else {
+        cap = min_cap;
+        if (arena->current) {
+            cap = arena->current->cap < max_cap / 2 ? arena->current->cap * 2 : max_cap;
+        }
+        if (cap < min_cap) cap = min_cap;
+        if (cap < needed) cap = needed;
+
+        chunk = tl_arena__new_chunk(cap);
+        if (!chunk) return NULL;
+    }
+
+    if (arena->current) {
+        arena->current->next = chunk;
+    } else {
+        arena->chunks = chunk;
+    }
+    arena->current = chunk;
     return chunk;
 }
 
@@ -278,58 +380,78 @@ void *
 tl_arena_alloc_aligned(TL_Arena *arena, size_t size, size_t align)
 {
     TL_ArenaChunk *chunk;
-    uintptr_t current;
-    uintptr_t aligned;
-    size_t end_used;
-    size_t needed_cap;
+    void *ptr;
 
     assert(arena != NULL);
     align = tl_normalize_align(align);
     if (align == 0 || size == 0) return NULL;
 
-    chunk = tl_arena__last_chunk(arena);
-    if (chunk) {
-        current = (uintptr_t)chunk->data + chunk->used;
-        aligned = tl_align_up_ptr(current, align);
-        if (aligned != 0 && aligned >= (uintptr_t)chunk->data) {
-            end_used = (size_t)(aligned - (uintptr_t)chunk->data);
-            if (end_used <= chunk->cap && size <= chunk->cap - end_used) {
-                chunk->used = end_used + size;
-                return (void *)aligned;
-            }
-        }
+    if (arena->current) {
+        ptr = tl_arena__bump(arena->current, size, align);
+        if (ptr) return ptr;
     }
 
     if (size > SIZE_MAX - (align - 1U)) return NULL;
-    needed_cap = size + align - 1U;
-    if (needed_cap < TL_ARENA_INITIAL_CAP) needed_cap = TL_ARENA_INITIAL_CAP;
 
-    chunk = tl_arena__add_chunk(needed_cap);
+    chunk = tl_arena__grow(arena, size + align - 1U);
     if (!chunk) return NULL;
 
-    if (!arena->chunks) {
-        arena->chunks = chunk;
-    } else {
-        tl_arena__last_chunk(arena)->next = chunk;
-    }
+    return tl_arena__bump(chunk, size, align);
+}
 
-    current = (uintptr_t)chunk->data;
-    aligned = tl_align_up_ptr(current, align);
-    if (aligned == 0 || aligned < (uintptr_t)chunk->data) return NULL;
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_arena_alloc(TL_Arena *arena, size_t size)
+{
+    return tl_arena_alloc_aligned(arena, size, TL_MEM_ALIGN);
+}
 
-    end_used = (size_t)(aligned - (uintptr_t)chunk->data);
-    if (end_used > chunk->cap || size > chunk->cap - end_used) return NULL;
+static inline
+b32_t
+tl_arena__is_top(const TL_ArenaChunk *chunk, const void *ptr, size_t size)
+{
+    uintptr_t p = (uintptr_t)ptr;
+    uintptr_t data = (uintptr_t)chunk->data;
 
-    chunk->used = end_used + size;
-    return (void *)aligned;
+    return p >= data && p - data <= chunk->used && chunk->used - (size_t)(p - data) == size;
 }
 
+/*
+ * When `ptr` is the most recent allocation in the current chunk it grows or
+ * shrinks in place as long as the chunk has room; otherwise the block is
+ * copied to a new allocation and the old bytes stay in the arena.
+ */
 TL_ATTR_MAYBE_UNUSED
 static inline
 void *
-tl_arena_alloc(TL_Arena *arena, size_t size)
+tl_arena_realloc_aligned(TL_Arena *arena,
+                         void *ptr,
+                         size_t old_size,
+                         size_t new_size,
+                         size_t align)
 {
-    return tl_arena_alloc_aligned(arena, size, TL_MEM_ALIGN);
+    TL_ArenaChunk *chunk;
+    void *next;
+
+    assert(arena != NULL);
+    if (!ptr) return tl_arena_alloc_aligned(arena, new_size, align);
+    if (new_size == 0) return NULL;
+
+    chunk = arena->current;
+    if (chunk && tl_arena__is_top(chunk, ptr, old_size)) {
+        size_t offset = (size_t)((byte_t *)ptr - chunk->data);
+
+        if (new_size <= chunk->cap - offset) {
+            chunk->used = offset + new_size;
+            return ptr;
+        }
+    }
+
+    next = tl_arena_alloc_aligned(arena, new_size, align);
+    if (!next) return NULL;
+    memcpy(next, ptr, old_size < new_size ? old_size : new_size);
+    return next;
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -337,68 +459,76 @@ static inline
 TL_ArenaMark
 tl_arena_mark(TL_Arena *arena)
 {
-    TL_ArenaChunk *chunk = tl_arena__last_chunk(arena);
+    TL_ArenaChunk *chunk = arena->current;
     return (TL_ArenaMark){
         .chunk = chunk,
         .used = chunk ? chunk->used : 0,
     };
 }
 
+/* Chunks after the mark move to the free list, in order, so a workload that
+ * repeats after a restore reuses them one by one. */
 TL_ATTR_MAYBE_UNUSED
 static inline
 void
 tl_arena_restore(TL_Arena *arena, TL_ArenaMark mark)
 {
-    TL_ArenaChunk *chunk;
-    TL_ArenaChunk *next;
+    TL_ArenaChunk *detached;
+    TL_ArenaChunk *tail;
 
     assert(arena != NULL);
+    tail = arena->current;
     if (!mark.chunk) {
-        chunk = arena->chunks;
+        detached = arena->chunks;
         arena->chunks = NULL;
+        arena->current = NULL;
     } else {
         mark.chunk->used = mark.used;
-        chunk = mark.chunk->next;
+        detached = mark.chunk->next;
         mark.chunk->next = NULL;
+        arena->current = mark.chunk;
     }
 
-    while (chunk) {
-        next = chunk->next;
-        free(chunk->data);
-        free(chunk);
-        chunk = next;
+    if (detached) {
+        tail->next = arena->free_chunks;
+        arena->free_chunks = detached;
     }
 }
 
+/* Keeps the first chunk as current and recycles the rest. */
 TL_ATTR_MAYBE_UNUSED
 static inline
 void
 tl_arena_reset(TL_Arena *arena)
 {
-    TL_ArenaChunk *chunk;
     assert(arena != NULL);
-    for (chunk = arena->chunks; chunk; chunk = chunk->next) {
-        chunk->used = 0;
-    }
+    tl_arena_restore(arena, (TL_ArenaMark){ .chunk = arena->chunks, .used = 0 });
 }
 
-TL_ATTR_MAYBE_UNUSED
 static inline
 void
-tl_arena_destroy(TL_Arena *arena)
+tl_arena__free_chunks(TL_ArenaChunk *chunk)
 {
-    TL_ArenaChunk *chunk;
     TL_ArenaChunk *next;
 
-    if (!arena) return;
-    chunk = arena->chunks;
     while (chunk) {
         next = chunk->next;
-        free(chunk->data);
         free(chunk);
         chunk = next;
     }
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_arena_destroy(TL_Arena *arena)
+{
+    if (!arena) return;
+    tl_arena__free_chunks(arena->chunks);
+    tl_arena__free_chunks(arena->free_chunks);
     arena->chunks = NULL;
+    arena->current = NULL;
+    arena->free_chunks = NULL;
 }
 
 static inline
@@ -409,14 +539,20 @@ tl_allocator_arena_alloc(void *ctx, size_t size, size_t align)
     return tl_arena_alloc_aligned((TL_Arena *)ctx, size, align);
 }
 
+/* Only the most recent allocation is given back; anything else waits for
+ * restore/reset. */
 static inline
 void
 tl_allocator_arena_free(void *ctx, void *ptr, size_t size, size_t align)
 {
-    (void)ctx;
-    (void)ptr;
-    (void)size;
+    TL_ArenaChunk *chunk;
+
     (void)align;
+    assert(ctx != NULL);
+    chunk = ((TL_Arena *)ctx)->current;
+    if (ptr && chunk && tl_arena__is_top(chunk, ptr, size)) {
+        chunk->used = (size_t)((byte_t *)ptr - chunk->data);
+    }
 }
 
 static inline
@@ -427,16 +563,8 @@ tl_allocator_arena_realloc(void *ctx,
                            size_t new_size,
                            size_t align)
 {
-    void *next;
-
     assert(ctx != NULL);
-    if (!ptr) return tl_allocator_arena_alloc(ctx, new_size, align);
-    if (new_size == 0) return NULL;
-
-    next = tl_allocator_arena_alloc(ctx, new_size, align);
-    if (!next) return NULL;
-    memcpy(next, ptr, old_size < new_size ? old_size : new_size);
-    return next;
+    return tl_arena_realloc_aligned((TL_Arena *)ctx, ptr, old_size, new_size, align);
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -465,18 +593,38 @@ tl_destroy_arena(TL_Arena *arena)
     tl_arena_destroy(arena);
 }
 
-/* fixed-size object pool */
+/* fixed-size object pool
+ *
+ * Each chunk is one allocation aligned to its own power-of-two size, with
+ * its header at the start, so a block finds its chunk by masking the
+ * address. Every chunk keeps its own free list and free count; blocks are
+ * carved lazily, so untouched parts of a chunk stay out of RSS.
+ *
+ * Allocation bumps `current` until it is full, then moves to the fullest
+ * partially used chunk (chunks sit in TL_FIXED_POOL_BINS bins by how free
+ * they are) to keep the working set dense, then to an empty chunk, and only
+ * then allocates a new one. tl_fixed_pool_trim() releases empty chunks.
+ */
 
 #define TL_FIXED_POOL_DEFAULT_BLOCKS_PER_CHUNK 64
+#define TL_FIXED_POOL_BINS                     8
+#define TL_FIXED_POOL_MMAP_MIN                 (64 * 1024)
 
 typedef struct TL_FixedPoolFreeNode {
     struct TL_FixedPoolFreeNode *next;
 } TL_FixedPoolFreeNode;
 
 typedef struct TL_FixedPoolChunk {
-    void *data;
-    size_t size;
-    struct TL_FixedPoolChunk *next;
+    void *data;                        /* first block */
+    size_t size;                       /* bytes of the whole allocation */
+    struct TL_FixedPoolChunk *next;    /* all chunks */
+    struct TL_FixedPoolChunk *prev;
+    struct TL_FixedPoolChunk *bin_next;
+    struct TL_FixedPoolChunk *bin_prev;
+    TL_FixedPoolFreeNode *free_list;
+    size_t free_count;                 /* free_list + never carved blocks */
+    size_t carved;                     /* blocks handed out at least once */
+    int bin;                           /* -1: full or current */
 } TL_FixedPoolChunk;
 
 typedef struct TL_FixedPool {
@@ -484,10 +632,22 @@ typedef struct TL_FixedPool {
     size_t block_align;
     size_t block_stride;
     size_t blocks_per_chunk;
+    size_t chunk_bytes;                /* power of two, also the chunk alignment */
+    size_t chunk_count;
+    TL_Allocator *backing;             /* chunk source; NULL for the OS/heap */
     TL_FixedPoolChunk *chunks;
-    TL_FixedPoolFreeNode *free_list;
+    TL_FixedPoolChunk *current;
+    /* [0, BINS): partially free, fullest first; [BINS]: completely free */
+    TL_FixedPoolChunk *bins[TL_FIXED_POOL_BINS + 1];
 } TL_FixedPool;
 
+static inline
+size_t
+tl_fixed_pool__header_size(size_t block_align)
+{
+    return tl_align_up(sizeof(TL_FixedPoolChunk), block_align);
+}
+
 TL_ATTR_MAYBE_UNUSED
 static inline
 b32_t
@@ -497,6 +657,8 @@ tl_fixed_pool_init(TL_FixedPool *pool,
                    size_t blocks_per_chunk)
 {
     size_t stride_base;
+    size_t header;
+    size_t bytes;
 
     assert(pool != NULL);
     block_align = tl_normalize_align(block_align);
@@ -506,48 +668,175 @@ tl_fixed_pool_init(TL_FixedPool *pool,
     stride_base = tl_align_up(stride_base, block_align);
     if (stride_base == 0) return 0;
 
+    if (!blocks_per_chunk) blocks_per_chunk = TL_FIXED_POOL_DEFAULT_BLOCKS_PER_CHUNK;
+    header = tl_fixed_pool__header_size(block_align);
+    if (header == 0 || blocks_per_chunk > (SIZE_MAX / 2 - header) / stride_base) return 0;
+
+    /* round the chunk up to a power of two and fill the slack with blocks */
+    bytes = header + blocks_per_chunk * stride_base;
+    while (bytes & (bytes - 1U)) bytes += bytes & (~bytes + 1U);
+
+    memset(pool, 0, sizeof(*pool));
     pool->block_size = block_size;
     pool->block_align = block_align;
     pool->block_stride = stride_base;
-    pool->blocks_per_chunk = blocks_per_chunk ? blocks_per_chunk : TL_FIXED_POOL_DEFAULT_BLOCKS_PER_CHUNK;
-    pool->chunks = NULL;
-    pool->free_list = NULL;
+    pool->blocks_per_chunk = (bytes - header) / stride_base;
+    pool->chunk_bytes = bytes;
     return 1;
 }
 
+/*
+ * Take chunks from `backing` (e.g. a TL_BuddyAllocator) instead of the
+ * OS/heap. It must honour alignments up to chunk_bytes. Call before the
+ * first allocation; NULL restores the default.
+ */
+TL_ATTR_MAYBE_UNUSED
 static inline
-b32_t
+void
+tl_fixed_pool_set_backing(TL_FixedPool *pool, TL_Allocator *backing)
+{
+    assert(pool != NULL && pool->chunks == NULL);
+    pool->backing = backing;
+}
+
+/*
+ * Chunks come from `backing` when one is set. Otherwise chunks of
+ * TL_FIXED_POOL_MMAP_MIN bytes or more are mapped directly, so trimming them
+ * unmaps the pages instead of leaving holes in the malloc heap.
+ */
+static inline
+void *
+tl_fixed_pool__chunk_alloc(const TL_FixedPool *pool)
+{
+    size_t bytes = pool->chunk_bytes;
+
+    if (pool->backing) return tl_allocator_alloc_aligned(pool->backing, bytes, bytes);
+#if defined(TL_MEM__HAS_MMAP)
+    if (bytes >= TL_FIXED_POOL_MMAP_MIN) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t len = bytes + (bytes > page ? bytes - page : 0);
+        uintptr_t base;
+        uintptr_t aligned;
+        void *p;
+
+        /* over-map, then unmap the misaligned head and the tail */
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return NULL;
+        base = (uintptr_t)p;
+        aligned = tl_align_up_ptr(base, bytes);
+        if (aligned > base) munmap(p, aligned - base);
+        if (base + len > aligned + bytes) munmap((void *)(aligned + bytes), base + len - aligned - bytes);
+        return (void *)aligned;
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    {
+        void *p = NULL;
+        return posix_memalign(&p, bytes, bytes) == 0 ? p : NULL;
+    }
+#else
+    return tl_allocator_std_alloc(NULL, bytes, bytes);
+#endif
+}
+
+static inline
+void
+tl_fixed_pool__chunk_free(const TL_FixedPool *pool, void *p, size_t bytes)
+{
+    if (pool->backing) {
+        tl_allocator_free_aligned(pool->backing, p, bytes, bytes);
+        return;
+    }
+#if defined(TL_MEM__HAS_MMAP)
+    if (bytes >= TL_FIXED_POOL_MMAP_MIN) {
+        munmap(p, bytes);
+        return;
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    (void)bytes;
+    free(p);
+#else
+    tl_allocator_std_free(NULL, p, bytes, bytes);
+#endif
+}
+
+static inline
+int
+tl_fixed_pool__bin_of(const TL_FixedPool *pool, size_t free_count)
+{
+    if (free_count == 0) return -1;
+    if (free_count == pool->blocks_per_chunk) return TL_FIXED_POOL_BINS;
+    return (int)(free_count * TL_FIXED_POOL_BINS / pool->blocks_per_chunk);
+}
+
+static inline
+void
+tl_fixed_pool__bin_unlink(TL_FixedPool *pool, TL_FixedPoolChunk *chunk)
+{
+    if (chunk->bin < 0) return;
+    if (chunk->bin_prev) {
+        chunk->bin_prev->bin_next = chunk->bin_next;
+    } else {
+        pool->bins[chunk->bin] = chunk->bin_next;
+    }
+    if (chunk->bin_next) chunk->bin_next->bin_prev = chunk->bin_prev;
+    chunk->bin_next = NULL;
+    chunk->bin_prev = NULL;
+    chunk->bin = -1;
+}
+
+static inline
+void
+tl_fixed_pool__bin_link(TL_FixedPool *pool, TL_FixedPoolChunk *chunk, int bin)
+{
+    chunk->bin = bin;
+    if (bin < 0) return;
+    chunk->bin_prev = NULL;
+    chunk->bin_next = pool->bins[bin];
+    if (chunk->bin_next) chunk->bin_next->bin_prev = chunk;
+    pool->bins[bin] = chunk;
+}
+
+static inline
+TL_FixedPoolChunk *
 tl_fixed_pool__add_chunk(TL_FixedPool *pool)
 {
     TL_FixedPoolChunk *chunk;
-    size_t total_size;
-    size_t i;
 
     assert(pool != NULL);
-    if (pool->blocks_per_chunk > SIZE_MAX / pool->block_stride) return 0;
-    total_size = pool->blocks_per_chunk * pool->block_stride;
-
-    chunk = (TL_FixedPoolChunk *)malloc(sizeof(TL_FixedPoolChunk));
-    if (!chunk) return 0;
+    chunk = (TL_FixedPoolChunk *)tl_fixed_pool__chunk_alloc(pool);
+    if (!chunk) return NULL;
 
-    chunk->data = tl_allocator_std_alloc(NULL, total_size, pool->block_align);
-    if (!chunk->data) {
-        free(chunk);
-        return 0;
-    }
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->data = (byte_t *)chunk + tl_fixed_pool__header_size(pool->block_align);
+    chunk->size = pool->chunk_bytes;
+    chunk->free_count = pool->blocks_per_chunk;
+    chunk->bin = -1;
 
-    chunk->size = total_size;
     chunk->next = pool->chunks;
+    if (pool->chunks) pool->chunks->prev = chunk;
     pool->chunks = chunk;
+    ++pool->chunk_count;
+    return chunk;
+}
 
-    for (i = 0; i < pool->blocks_per_chunk; ++i) {
-        TL_FixedPoolFreeNode *node =
-            (TL_FixedPoolFreeNode *)((byte_t *)chunk->data + i * pool->block_stride);
-        node->next = pool->free_list;
-        pool->free_list = node;
-    }
+/* Fullest partially used chunk, then an empty one, then a new one. */
+static inline
+TL_FixedPoolChunk *
+tl_fixed_pool__next_current(TL_FixedPool *pool)
+{
+    TL_FixedPoolChunk *chunk = NULL;
+    int bin;
 
-    return 1;
+    for (bin = 0; bin <= TL_FIXED_POOL_BINS && !chunk; ++bin) {
+        chunk = pool->bins[bin];
+    }
+    if (chunk) {
+        tl_fixed_pool__bin_unlink(pool, chunk);
+        return chunk;
+    }
+    return tl_fixed_pool__add_chunk(pool);
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -555,6 +844,7 @@ static inline
 void *
 tl_fixed_pool_alloc(TL_FixedPool *pool, size_t size, size_t align)
 {
+    TL_FixedPoolChunk *chunk;
     TL_FixedPoolFreeNode *node;
 
     assert(pool != NULL);
@@ -562,11 +852,21 @@ tl_fixed_pool_alloc(TL_FixedPool *pool, size_t size, size_t align)
     if (align == 0 || size == 0) return NULL;
     if (size > pool->block_size || align > pool->block_align) return NULL;
 
-    if (!pool->free_list && !tl_fixed_pool__add_chunk(pool)) return NULL;
+    chunk = pool->current;
+    if (!chunk || chunk->free_count == 0) {
+        /* the old current is full: it stays off the bins until a free */
+        chunk = tl_fixed_pool__next_current(pool);
+        if (!chunk) return NULL;
+        pool->current = chunk;
+    }
 
-    node = pool->free_list;
-    pool->free_list = node->next;
-    return node;
+    --chunk->free_count;
+    node = chunk->free_list;
+    if (node) {
+        chunk->free_list = node->next;
+        return node;
+    }
+    return (byte_t *)chunk->data + chunk->carved++ * pool->block_stride;
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -574,12 +874,58 @@ static inline
 void
 tl_fixed_pool_free(TL_FixedPool *pool, void *ptr)
 {
+    TL_FixedPoolChunk *chunk;
     TL_FixedPoolFreeNode *node;
+    int bin;
 
     if (!pool || !ptr) return;
+    chunk = (TL_FixedPoolChunk *)((uintptr_t)ptr & ~(uintptr_t)(pool->chunk_bytes - 1U));
+
     node = (TL_FixedPoolFreeNode *)ptr;
-    node->next = pool->free_list;
-    pool->free_list = node;
+    node->next = chunk->free_list;
+    chunk->free_list = node;
+    ++chunk->free_count;
+
+    if (chunk == pool->current) return;
+    bin = tl_fixed_pool__bin_of(pool, chunk->free_count);
+    if (bin != chunk->bin) {
+        tl_fixed_pool__bin_unlink(pool, chunk);
+        tl_fixed_pool__bin_link(pool, chunk, bin);
+    }
+}
+
+/*
+ * Release every completely free chunk, including an idle current chunk.
+ * Returns the number of chunks released.
+ */
+TL_ATTR_MAYBE_UNUSED
+static inline
+size_t
+tl_fixed_pool_trim(TL_FixedPool *pool)
+{
+    TL_FixedPoolChunk *chunk;
+    size_t released = 0;
+
+    if (!pool) return 0;
+    if (pool->current && pool->current->free_count == pool->blocks_per_chunk) {
+        tl_fixed_pool__bin_link(pool, pool->current, TL_FIXED_POOL_BINS);
+        pool->current = NULL;
+    }
+
+    while ((chunk = pool->bins[TL_FIXED_POOL_BINS]) != NULL) {
+        tl_fixed_pool__bin_unlink(pool, chunk);
+        if (chunk->prev) {
+            chunk->prev->next = chunk->next;
+        } else {
+            pool->chunks = chunk->next;
+        }
+        if (chunk->next) chunk->next->prev = chunk->prev;
+        tl_fixed_pool__chunk_free(pool, chunk, chunk->size);
+        --pool->chunk_count;
+        ++released;
+    }
+
+    return released;
 }
 
 TL_ATTR_MAYBE_UNUSED
@@ -589,17 +935,19 @@ tl_fixed_pool_destroy(TL_FixedPool *pool)
 {
     TL_FixedPoolChunk *chunk;
     TL_FixedPoolChunk *next;
+    int bin;
 
     if (!pool) return;
     chunk = pool->chunks;
     while (chunk) {
         next = chunk->next;
-        tl_allocator_std_free(NULL, chunk->data, chunk->size, pool->block_align);
-        free(chunk);
+        tl_fixed_pool__chunk_free(pool, chunk, chunk->size);
         chunk = next;
     }
     pool->chunks = NULL;
-    pool->free_list = NULL;
+    pool->current = NULL;
+    pool->chunk_count = 0;
+    for (bin = 0; bin <= TL_FIXED_POOL_BINS; ++bin) pool->bins[bin] = NULL;
 }
 
 static inline
@@ -662,26 +1010,2368 @@ tl_get_allocator_fixed_pool(TL_FixedPool *pool)
     };
 }
 
-TL_ATTR_MAYBE_UNUSED
-static const TL_Allocator tl_default_allocator = (TL_Allocator){
-    .vt = &tl_allocatorvt_std,
-    .ctx = NULL,
-};
+/* concurrent fixed-size object pool
+ *
+ * Same blocks as TL_FixedPool, shareable between threads. Each thread owns a
+ * magazine (a small array of free blocks) in the pool; alloc and free touch
+ * only that magazine. An empty magazine refills, and a full one drains, a
+ * batch of TL_CONCURRENT_POOL_BATCH blocks at a time through a global
+ * lock-free stack of batches. The stack head is a pointer packed with a
+ * version tag so a pop that raced with a pop/push of the same batch fails
+ * its CAS instead of corrupting the stack (ABA).
+ *
+ * A block may be freed on any thread; it lands in that thread's magazine.
+ * Threads beyond TL_CONCURRENT_POOL_MAX_THREADS fall back to the global
+ * stack. A thread that stops using the pool for good can hand its blocks and
+ * its magazine slot back with tl_concurrent_fixed_pool_thread_flush().
+ *
+ * init and destroy are not thread-safe. Needs GCC/Clang __atomic builtins
+ * and user-space pointers below 2^48 on 64-bit targets.
+ */
 
-#define TL_TEMP_SCOPE(arena_name) \
-    for (TL_Arena arena_name = {0}; \
-         (arena_name).chunks != (TL_ArenaChunk *)(uintptr_t)1; \
-         tl_arena_destroy(&(arena_name)), (arena_name).chunks = (TL_ArenaChunk *)(uintptr_t)1)
+#if defined(__GNUC__) || defined(__clang__)
+#define TL_HAS_CONCURRENT_POOL 1
 
-#if defined(TL_MEM_SHORT_NAMES) || defined(TL_SHORT_NAMES)
-#define TEMP_SCOPE TL_TEMP_SCOPE
+#define TL_CONCURRENT_POOL_MAGAZINE_SIZE 64
+#define TL_CONCURRENT_POOL_BATCH         (TL_CONCURRENT_POOL_MAGAZINE_SIZE / 2)
+#define TL_CONCURRENT_POOL_MAX_THREADS   64
 
-typedef TL_Allocator       Allocator;
-typedef TL_AllocatorVTable AllocatorVTable;
-typedef TL_ArenaChunk      ArenaChunk;
-typedef TL_Arena           Arena;
-typedef TL_ArenaMark       ArenaMark;
-typedef TL_FixedPool       FixedPool;
+typedef struct TL_ConcurrentPoolNode {
+    struct TL_ConcurrentPoolNode *next;       /* next block in this batch */
+    struct TL_ConcurrentPoolNode *next_batch; /* next batch on the stack */
+} TL_ConcurrentPoolNode;
+
+typedef struct TL_ConcurrentPoolMagazine {
+    size_t count;
+    void *blocks[TL_CONCURRENT_POOL_MAGAZINE_SIZE];
+    /* keep neighbouring threads' magazines off each other's cache lines */
+    byte_t pad[64 - sizeof(size_t)];
+} TL_ConcurrentPoolMagazine;
+
+typedef struct TL_ConcurrentFixedPool {
+    size_t block_size;
+    size_t block_align;
+    size_t block_stride;
+    size_t blocks_per_chunk;
+    TL_FixedPoolChunk *chunks;           /* atomic push only */
+    const void **owners;                 /* per magazine: owning thread token */
+    TL_ConcurrentPoolMagazine *magazines;
+    byte_t pad[64];                      /* keep the contended head apart */
+    uint64_t free_batches;               /* tagged TL_ConcurrentPoolNode * */
+} TL_ConcurrentFixedPool;
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define TL_CONCURRENT_POOL__PTR_BITS 48
+#else
+#define TL_CONCURRENT_POOL__PTR_BITS 32
+#endif
+#define TL_CONCURRENT_POOL__PTR_MASK (((uint64_t)1 << TL_CONCURRENT_POOL__PTR_BITS) - 1U)
+
+static inline
+uint64_t
+tl_concurrent_pool__pack(TL_ConcurrentPoolNode *node, uint64_t tagged)
+{
+    uint64_t tag = (tagged >> TL_CONCURRENT_POOL__PTR_BITS) + 1U;
+    return ((uint64_t)(uintptr_t)node & TL_CONCURRENT_POOL__PTR_MASK)
+         | (tag << TL_CONCURRENT_POOL__PTR_BITS);
+}
+
+static inline
+TL_ConcurrentPoolNode *
+tl_concurrent_pool__unpack(uint64_t tagged)
+{
+    return (TL_ConcurrentPoolNode *)(uintptr_t)(tagged & TL_CONCURRENT_POOL__PTR_MASK);
+}
+
+/* Push a batch already linked through ->next. */
+static inline
+void
+tl_concurrent_pool__push_batch(TL_ConcurrentFixedPool *pool, TL_ConcurrentPoolNode *batch)
+{
+    uint64_t head = __atomic_load_n(&pool->free_batches, __ATOMIC_RELAXED);
+    uint64_t next;
+
+    do {
+        __atomic_store_n(&batch->next_batch, tl_concurrent_pool__unpack(head), __ATOMIC_RELAXED);
+        next = tl_concurrent_pool__pack(batch, head);
+    } while (!__atomic_compare_exchange_n(&pool->free_batches, &head, next, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static inline
+TL_ConcurrentPoolNode *
+tl_concurrent_pool__pop_batch(TL_ConcurrentFixedPool *pool)
+{
+    uint64_t head = __atomic_load_n(&pool->free_batches, __ATOMIC_ACQUIRE);
+    TL_ConcurrentPoolNode *batch;
+    uint64_t next;
+
+    do {
+        batch = tl_concurrent_pool__unpack(head);
+        if (!batch) return NULL;
+        /* batch may be popped and reused under us; it stays mapped until
+         * destroy, and the tag makes our CAS fail if that happened */
+        next = tl_concurrent_pool__pack(__atomic_load_n(&batch->next_batch, __ATOMIC_RELAXED), head);
+    } while (!__atomic_compare_exchange_n(&pool->free_batches, &head, next, 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return batch;
+}
+
+/* Link blocks[0..count) into a batch and push it. */
+static inline
+void
+tl_concurrent_pool__push_blocks(TL_ConcurrentFixedPool *pool, void **blocks, size_t count)
+{
+    size_t i;
+
+    if (count == 0) return;
+    for (i = 0; i + 1 < count; ++i) {
+        ((TL_ConcurrentPoolNode *)blocks[i])->next = (TL_ConcurrentPoolNode *)blocks[i + 1];
+    }
+    ((TL_ConcurrentPoolNode *)blocks[count - 1])->next = NULL;
+    tl_concurrent_pool__push_batch(pool, (TL_ConcurrentPoolNode *)blocks[0]);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_concurrent_fixed_pool_init(TL_ConcurrentFixedPool *pool,
+                              size_t block_size,
+                              size_t block_align,
+                              size_t blocks_per_chunk)
+{
+    size_t stride_base;
+
+    assert(pool != NULL);
+    block_align = tl_normalize_align(block_align);
+    if (block_size == 0 || block_align == 0) return 0;
+
+    stride_base = TL_MAX(block_size, sizeof(TL_ConcurrentPoolNode));
+    stride_base = tl_align_up(stride_base, block_align);
+    if (stride_base == 0) return 0;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->owners = (const void **)calloc(TL_CONCURRENT_POOL_MAX_THREADS, sizeof(*pool->owners));
+    pool->magazines = (TL_ConcurrentPoolMagazine *)calloc(TL_CONCURRENT_POOL_MAX_THREADS,
+                                                          sizeof(*pool->magazines));
+    if (!pool->owners || !pool->magazines) {
+        free(pool->owners);
+        free(pool->magazines);
+        return 0;
+    }
+
+    pool->block_size = block_size;
+    pool->block_align = block_align;
+    pool->block_stride = stride_base;
+    pool->blocks_per_chunk = TL_MAX(blocks_per_chunk ? blocks_per_chunk : TL_FIXED_POOL_DEFAULT_BLOCKS_PER_CHUNK,
+                                    (size_t)TL_CONCURRENT_POOL_MAGAZINE_SIZE);
+    return 1;
+}
+
+/* One per thread for the whole program: weak, so the definition in every
+ * translation unit links to the same variable. A static thread-local would
+ * give each .c file its own copy, and a thread would own one magazine per
+ * file it used the pool from. */
+__attribute__((weak)) TL_THREAD_LOCAL char tl__concurrent_pool_thread_token;
+
+/*
+ * The calling thread's magazine, claimed on first use; NULL once every slot
+ * is taken. A thread is identified by the address of its
+ * tl__concurrent_pool_thread_token, which is unique among live threads; a
+ * new thread that gets a dead one's address simply inherits its magazine.
+ * The slot cache is per translation unit, but it only remembers slots whose
+ * owner is rechecked on every hit.
+ */
+static inline
+TL_ConcurrentPoolMagazine *
+tl_concurrent_pool__magazine(TL_ConcurrentFixedPool *pool)
+{
+    static TL_THREAD_LOCAL struct {
+        const TL_ConcurrentFixedPool *pool;
+        size_t slot;
+    } cache[4];
+    static TL_THREAD_LOCAL size_t cache_next;
+    const void *token = &tl__concurrent_pool_thread_token;
+    size_t i;
+
+    /* the cache may name a destroyed pool at the same address: recheck owner */
+    for (i = 0; i < TL_COUNT_OF(cache); ++i) {
+        if (cache[i].pool == pool
+         && __atomic_load_n(&pool->owners[cache[i].slot], __ATOMIC_RELAXED) == token) {
+            return &pool->magazines[cache[i].slot];
+        }
+    }
+
+    for (i = 0; i < TL_CONCURRENT_POOL_MAX_THREADS; ++i) {
+        const void *owner = __atomic_load_n(&pool->owners[i], __ATOMIC_RELAXED);
+        if (owner == token
+         || (owner == NULL
+          && __atomic_compare_exchange_n(&pool->owners[i], &owner, token, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+            cache[cache_next].pool = pool;
+            cache[cache_next].slot = i;
+            cache_next = (cache_next + 1) % TL_COUNT_OF(cache);
+            return &pool->magazines[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Carve a new chunk: fill `out` with up to `want` blocks, push the rest. */
+static inline
+size_t
+tl_concurrent_pool__add_chunk(TL_ConcurrentFixedPool *pool, void **out, size_t want)
+{
+    TL_FixedPoolChunk *chunk;
+    void *batch[TL_CONCURRENT_POOL_BATCH];
+    size_t total_size;
+    size_t taken = 0;
+    size_t pending = 0;
+    size_t i;
+
+    if (pool->blocks_per_chunk > SIZE_MAX / pool->block_stride) return 0;
+    total_size = pool->blocks_per_chunk * pool->block_stride;
+
+    chunk = (TL_FixedPoolChunk *)malloc(sizeof(TL_FixedPoolChunk));
+    if (!chunk) return 0;
+
+    chunk->data = tl_allocator_std_alloc(NULL, total_size, pool->block_align);
+    if (!chunk->data) {
+        free(chunk);
+        return 0;
+    }
+    chunk->size = total_size;
+
+    chunk->next = __atomic_load_n(&pool->chunks, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&pool->chunks, &chunk->next, chunk, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+
+    for (i = 0; i < pool->blocks_per_chunk; ++i) {
+        void *block = (byte_t *)chunk->data + i * pool->block_stride;
+
+        if (taken < want) {
+            out[taken++] = block;
+            continue;
+        }
+        batch[pending++] = block;
+        if (pending == TL_CONCURRENT_POOL_BATCH) {
+            tl_concurrent_pool__push_blocks(pool, batch, pending);
+            pending = 0;
+        }
+    }
+    tl_concurrent_pool__push_blocks(pool, batch, pending);
+
+    return taken;
+}
+
+/* Move one batch (or a fresh chunk) into an empty magazine. */
+static inline
+b32_t
+tl_concurrent_pool__refill(TL_ConcurrentFixedPool *pool, TL_ConcurrentPoolMagazine *mag)
+{
+    TL_ConcurrentPoolNode *node = tl_concurrent_pool__pop_batch(pool);
+
+    if (!node) {
+        mag->count = tl_concurrent_pool__add_chunk(pool, mag->blocks, TL_CONCURRENT_POOL_BATCH);
+        return mag->count != 0;
+    }
+
+    while (node && mag->count < TL_CONCURRENT_POOL_MAGAZINE_SIZE) {
+        mag->blocks[mag->count++] = node;
+        node = node->next;
+    }
+    /* flushed magazines can push batches larger than a magazine */
+    if (node) tl_concurrent_pool__push_batch(pool, node);
+    return 1;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_concurrent_fixed_pool_alloc(TL_ConcurrentFixedPool *pool, size_t size, size_t align)
+{
+    TL_ConcurrentPoolMagazine *mag;
+    TL_ConcurrentPoolNode *node;
+    void *block = NULL;
+
+    assert(pool != NULL);
+    align = tl_normalize_align(align);
+    if (align == 0 || size == 0) return NULL;
+    if (size > pool->block_size || align > pool->block_align) return NULL;
+
+    mag = tl_concurrent_pool__magazine(pool);
+    if (mag) {
+        if (mag->count == 0 && !tl_concurrent_pool__refill(pool, mag)) return NULL;
+        return mag->blocks[--mag->count];
+    }
+
+    /* no magazine: take a batch, keep its head, return the rest */
+    node = tl_concurrent_pool__pop_batch(pool);
+    if (!node) {
+        if (!tl_concurrent_pool__add_chunk(pool, &block, 1)) return NULL;
+        return block;
+    }
+    if (node->next) tl_concurrent_pool__push_batch(pool, node->next);
+    return node;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_concurrent_fixed_pool_free(TL_ConcurrentFixedPool *pool, void *ptr)
+{
+    TL_ConcurrentPoolMagazine *mag;
+
+    if (!pool || !ptr) return;
+
+    mag = tl_concurrent_pool__magazine(pool);
+    if (!mag) {
+        tl_concurrent_pool__push_blocks(pool, &ptr, 1);
+        return;
+    }
+
+    if (mag->count == TL_CONCURRENT_POOL_MAGAZINE_SIZE) {
+        mag->count -= TL_CONCURRENT_POOL_BATCH;
+        tl_concurrent_pool__push_blocks(pool, mag->blocks + mag->count, TL_CONCURRENT_POOL_BATCH);
+    }
+    mag->blocks[mag->count++] = ptr;
+}
+
+/* Return the calling thread's cached blocks and give up its magazine slot. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_concurrent_fixed_pool_thread_flush(TL_ConcurrentFixedPool *pool)
+{
+    TL_ConcurrentPoolMagazine *mag;
+
+    if (!pool) return;
+    mag = tl_concurrent_pool__magazine(pool);
+    if (!mag) return;
+
+    tl_concurrent_pool__push_blocks(pool, mag->blocks, mag->count);
+    mag->count = 0;
+    __atomic_store_n(&pool->owners[mag - pool->magazines], NULL, __ATOMIC_RELEASE);
+}
+
+/* No other thread may use the pool during or after destroy. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_concurrent_fixed_pool_destroy(TL_ConcurrentFixedPool *pool)
+{
+    TL_FixedPoolChunk *chunk;
+    TL_FixedPoolChunk *next;
+
+    if (!pool) return;
+    chunk = pool->chunks;
+    while (chunk) {
+        next = chunk->next;
+        tl_allocator_std_free(NULL, chunk->data, chunk->size, pool->block_align);
+        free(chunk);
+        chunk = next;
+    }
+    free(pool->owners);
+    free(pool->magazines);
+    pool->chunks = NULL;
+    pool->owners = NULL;
+    pool->magazines = NULL;
+    pool->free_batches = 0;
+}
+
+static inline
+void *
+tl_allocator_concurrent_fixed_pool_alloc(void *ctx, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    return tl_concurrent_fixed_pool_alloc((TL_ConcurrentFixedPool *)ctx, size, align);
+}
+
+static inline
+void
+tl_allocator_concurrent_fixed_pool_free(void *ctx, void *ptr, size_t size, size_t align)
+{
+    (void)size;
+    (void)align;
+    assert(ctx != NULL);
+    tl_concurrent_fixed_pool_free((TL_ConcurrentFixedPool *)ctx, ptr);
+}
+
+static inline
+void *
+tl_allocator_concurrent_fixed_pool_realloc(void *ctx,
+                                           void *ptr,
+                                           size_t old_size,
+                                           size_t new_size,
+                                           size_t align)
+{
+    void *next;
+
+    assert(ctx != NULL);
+    if (!ptr) return tl_allocator_concurrent_fixed_pool_alloc(ctx, new_size, align);
+    if (new_size == 0) {
+        tl_allocator_concurrent_fixed_pool_free(ctx, ptr, old_size, align);
+        return NULL;
+    }
+
+    next = tl_allocator_concurrent_fixed_pool_alloc(ctx, new_size, align);
+    if (!next) return NULL;
+    memcpy(next, ptr, old_size < new_size ? old_size : new_size);
+    tl_allocator_concurrent_fixed_pool_free(ctx, ptr, old_size, align);
+    return next;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static const TL_AllocatorVTable tl_allocatorvt_concurrent_fixed_pool = {
+    .alloc = tl_allocator_concurrent_fixed_pool_alloc,
+    .free = tl_allocator_concurrent_fixed_pool_free,
+    .realloc = tl_allocator_concurrent_fixed_pool_realloc,
+};
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Allocator
+tl_get_allocator_concurrent_fixed_pool(TL_ConcurrentFixedPool *pool)
+{
+    return (TL_Allocator){
+        .vt = &tl_allocatorvt_concurrent_fixed_pool,
+        .ctx = pool,
+    };
+}
+
+#endif /* __GNUC__ || __clang__ */
+
+/* size-class slab allocator
+ *
+ * Requests up to TL_SLAB_MAX_SIZE bytes are rounded up to one of
+ * TL_SLAB_CLASS_COUNT size classes (8, 16, then steps of 16 to 128, then four
+ * classes per power of two) and served by that class's TL_FixedPool. Larger
+ * requests are mapped directly from the OS, over-aligned small ones go to
+ * the std allocator. The route depends only on (size, align), which every
+ * TL_Allocator free/realloc passes back, so blocks need no header.
+ *
+ * realloc within the same size class returns `ptr` unchanged; a large block
+ * shrinks in place by unmapping its tail pages and is copied to grow.
+ * Not thread-safe.
+ */
+
+#define TL_SLAB_MAX_SIZE    4096
+#define TL_SLAB_CLASS_COUNT 29
+#define TL_SLAB_CHUNK_BYTES (64 * 1024)
+
+typedef struct TL_SlabAllocator {
+    TL_FixedPool pools[TL_SLAB_CLASS_COUNT];
+    uint8_t class_of[TL_SLAB_MAX_SIZE / 8 + 1]; /* (size + 7) / 8 -> class */
+} TL_SlabAllocator;
+
+static const uint16_t tl_slab__class_sizes[TL_SLAB_CLASS_COUNT] = {
+    8, 16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096,
+};
+
+enum {
+    TL_SLAB__ROUTE_LARGE = -1, /* page mapping */
+    TL_SLAB__ROUTE_STD = -2,   /* tl_allocator_std_* */
+};
+
+static inline
+size_t
+tl_slab__page_size(void)
+{
+#if defined(TL_MEM__HAS_MMAP)
+    static size_t page;
+    if (!page) page = (size_t)sysconf(_SC_PAGESIZE);
+    return page;
+#else
+    return 4096;
+#endif
+}
+
+/* Size class index for (size, align), or a TL_SLAB__ROUTE_* value. */
+static inline
+int
+tl_slab__route(const TL_SlabAllocator *slab, size_t size, size_t align)
+{
+    int cls;
+
+    if (align > TL_MEM_ALIGN) {
+#if defined(TL_MEM__HAS_MMAP)
+        if (size > TL_SLAB_MAX_SIZE && align <= tl_slab__page_size()) return TL_SLAB__ROUTE_LARGE;
+#endif
+        return TL_SLAB__ROUTE_STD;
+    }
+    if (size > TL_SLAB_MAX_SIZE) {
+#if defined(TL_MEM__HAS_MMAP)
+        return TL_SLAB__ROUTE_LARGE;
+#else
+        return TL_SLAB__ROUTE_STD;
+#endif
+    }
+
+    cls = slab->class_of[(size + 7U) / 8U];
+    /* only the 8-byte class is less than max-aligned */
+    if (slab->pools[cls].block_align < align) ++cls;
+    return cls;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_slab_init(TL_SlabAllocator *slab)
+{
+    size_t i;
+    size_t cls = 0;
+
+    assert(slab != NULL);
+    memset(slab, 0, sizeof(*slab));
+
+    for (i = 0; i < TL_SLAB_CLASS_COUNT; ++i) {
+        size_t size = tl_slab__class_sizes[i];
+        size_t align = TL_MIN(size & (~size + 1U), (size_t)TL_MEM_ALIGN);
+        /* header included, so each pool chunk is exactly TL_SLAB_CHUNK_BYTES */
+        size_t per_chunk = (TL_SLAB_CHUNK_BYTES - tl_fixed_pool__header_size(align)) / size;
+
+        if (!tl_fixed_pool_init(&slab->pools[i], size, align, per_chunk)) return 0;
+    }
+
+    for (i = 0; i < TL_COUNT_OF(slab->class_of); ++i) {
+        while (tl_slab__class_sizes[cls] < i * 8U) ++cls;
+        slab->class_of[i] = (uint8_t)cls;
+    }
+    return 1;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_slab_destroy(TL_SlabAllocator *slab)
+{
+    size_t i;
+
+    if (!slab) return;
+    for (i = 0; i < TL_SLAB_CLASS_COUNT; ++i) {
+        tl_fixed_pool_destroy(&slab->pools[i]);
+    }
+}
+
+/* Release completely free chunks of every size class; returns the count. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+size_t
+tl_slab_trim(TL_SlabAllocator *slab)
+{
+    size_t released = 0;
+    size_t i;
+
+    if (!slab) return 0;
+    for (i = 0; i < TL_SLAB_CLASS_COUNT; ++i) {
+        released += tl_fixed_pool_trim(&slab->pools[i]);
+    }
+    return released;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_slab_alloc(TL_SlabAllocator *slab, size_t size, size_t align)
+{
+    int route;
+
+    assert(slab != NULL);
+    align = tl_normalize_align(align);
+    if (align == 0 || size == 0) return NULL;
+
+    route = tl_slab__route(slab, size, align);
+    if (route >= 0) return tl_fixed_pool_alloc(&slab->pools[route], size, align);
+
+#if defined(TL_MEM__HAS_MMAP)
+    if (route == TL_SLAB__ROUTE_LARGE) {
+        size_t len = tl_align_up(size, tl_slab__page_size());
+        void *p;
+
+        if (len == 0) return NULL;
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? NULL : p;
+    }
+#endif
+    return tl_allocator_std_alloc(NULL, size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_slab_free(TL_SlabAllocator *slab, void *ptr, size_t size, size_t align)
+{
+    int route;
+
+    if (!slab || !ptr) return;
+    align = tl_normalize_align(align);
+    if (align == 0) return;
+
+    route = tl_slab__route(slab, size, align);
+    if (route >= 0) {
+        tl_fixed_pool_free(&slab->pools[route], ptr);
+        return;
+    }
+
+#if defined(TL_MEM__HAS_MMAP)
+    if (route == TL_SLAB__ROUTE_LARGE) {
+        munmap(ptr, tl_align_up(size, tl_slab__page_size()));
+        return;
+    }
+#endif
+    tl_allocator_std_free(NULL, ptr, size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_slab_realloc(TL_SlabAllocator *slab,
+                void *ptr,
+                size_t old_size,
+                size_t new_size,
+                size_t align)
+{
+    int old_route;
+    int new_route;
+    void *next;
+
+    assert(slab != NULL);
+    if (!ptr) return tl_slab_alloc(slab, new_size, align);
+    if (new_size == 0) {
+        tl_slab_free(slab, ptr, old_size, align);
+        return NULL;
+    }
+
+    align = tl_normalize_align(align);
+    if (align == 0) return NULL;
+
+    old_route = tl_slab__route(slab, old_size, align);
+    new_route = tl_slab__route(slab, new_size, align);
+    if (old_route == new_route && old_route >= 0) return ptr;
+
+#if defined(TL_MEM__HAS_MMAP)
+    if (old_route == TL_SLAB__ROUTE_LARGE && new_route == TL_SLAB__ROUTE_LARGE) {
+        size_t page = tl_slab__page_size();
+        size_t old_len = tl_align_up(old_size, page);
+        size_t new_len = tl_align_up(new_size, page);
+
+        if (old_len == new_len) return ptr;
+        if (new_len < old_len) {
+            munmap((byte_t *)ptr + new_len, old_len - new_len);
+            return ptr;
+        }
+    }
+#endif
+
+    next = tl_slab_alloc(slab, new_size, align);
+    if (!next) return NULL;
+    memcpy(next, ptr, old_size < new_size ? old_size : new_size);
+    tl_slab_free(slab, ptr, old_size, align);
+    return next;
+}
+
+static inline
+void *
+tl_allocator_slab_alloc(void *ctx, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    return tl_slab_alloc((TL_SlabAllocator *)ctx, size, align);
+}
+
+static inline
+void
+tl_allocator_slab_free(void *ctx, void *ptr, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    tl_slab_free((TL_SlabAllocator *)ctx, ptr, size, align);
+}
+
+static inline
+void *
+tl_allocator_slab_realloc(void *ctx,
+                          void *ptr,
+                          size_t old_size,
+                          size_t new_size,
+                          size_t align)
+{
+    assert(ctx != NULL);
+    return tl_slab_realloc((TL_SlabAllocator *)ctx, ptr, old_size, new_size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static const TL_AllocatorVTable tl_allocatorvt_slab = {
+    .alloc = tl_allocator_slab_alloc,
+    .free = tl_allocator_slab_free,
+    .realloc = tl_allocator_slab_realloc,
+};
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Allocator
+tl_get_allocator_slab(TL_SlabAllocator *slab)
+{
+    return (TL_Allocator){
+        .vt = &tl_allocatorvt_slab,
+        .ctx = slab,
+    };
+}
+
+/* two-level segregated fit allocator
+ *
+ * General-purpose allocator with O(1) alloc, free and coalescing over a
+ * single region, either supplied by the caller or mapped by
+ * tl_tlsf_init_mapped(). Free blocks sit in TL_TLSF_FL_COUNT x
+ * TL_TLSF_SL_COUNT segregated lists: the first level is the power of two of
+ * the size, the second splits it into TL_TLSF_SL_COUNT linear steps. Two
+ * bitmaps find the smallest non-empty list that fits with two bit scans.
+ *
+ * Every block has a two-word header (previous physical block, size + flags)
+ * right before its payload. Adjacent free blocks are always merged, so the
+ * previous and next physical blocks are the only neighbours ever inspected.
+ * Requests are rounded up to the next list, so one may fail while a free
+ * block within 1/TL_TLSF_SL_COUNT of its size remains. Not thread-safe.
+ */
+
+#if SIZE_MAX > 0xffffffffu
+#define TL_TLSF_ALIGN_LOG2 4
+#define TL_TLSF_FL_MAX     40 /* blocks below 1TB */
+#else
+#define TL_TLSF_ALIGN_LOG2 3
+#define TL_TLSF_FL_MAX     30 /* blocks below 1GB */
+#endif
+#define TL_TLSF_ALIGN      ((size_t)1 << TL_TLSF_ALIGN_LOG2)
+#define TL_TLSF_SL_LOG2    5
+#define TL_TLSF_SL_COUNT   (1 << TL_TLSF_SL_LOG2)
+#define TL_TLSF_FL_SHIFT   (TL_TLSF_SL_LOG2 + TL_TLSF_ALIGN_LOG2)
+#define TL_TLSF_FL_COUNT   (TL_TLSF_FL_MAX - TL_TLSF_FL_SHIFT + 1)
+#define TL_TLSF_SMALL_SIZE ((size_t)1 << TL_TLSF_FL_SHIFT)
+#define TL_TLSF_MAX_SIZE   ((size_t)1 << (TL_TLSF_FL_MAX - 1))
+
+typedef struct TL_TlsfBlock {
+    struct TL_TlsfBlock *prev_phys; /* valid only while the previous block is free */
+    size_t size;                    /* payload bytes | TL_TLSF__FREE | TL_TLSF__PREV_FREE */
+    /* free blocks only, stored in the payload */
+    struct TL_TlsfBlock *next_free;
+    struct TL_TlsfBlock *prev_free;
+} TL_TlsfBlock;
+
+typedef struct TL_TlsfAllocator {
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[TL_TLSF_FL_COUNT];
+    TL_TlsfBlock *blocks[TL_TLSF_FL_COUNT][TL_TLSF_SL_COUNT];
+    void *region;
+    size_t region_size;
+    b32_t mapped;                   /* region is owned and released by destroy */
+} TL_TlsfAllocator;
+
+#define TL_TLSF__FREE       ((size_t)1)
+#define TL_TLSF__PREV_FREE  ((size_t)2)
+#define TL_TLSF__FLAGS      (TL_TLSF__FREE | TL_TLSF__PREV_FREE)
+#define TL_TLSF__HEADER     offsetof(TL_TlsfBlock, next_free)
+#define TL_TLSF__BLOCK_MIN  (sizeof(TL_TlsfBlock) - TL_TLSF__HEADER)
+
+/* Index of the highest set bit; x != 0. */
+static inline
+int
+tl_tlsf__fls(size_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (int)(sizeof(unsigned long long) * 8 - 1) - __builtin_clzll((unsigned long long)x);
+#else
+    int bit = 0;
+    while (x >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+/* Index of the lowest set bit; x != 0. */
+static inline
+int
+tl_tlsf__ffs(uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    int bit = 0;
+    while (!(x & 1U)) {
+        x >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+static inline
+size_t
+tl_tlsf__size(const TL_TlsfBlock *block)
+{
+    return block->size & ~TL_TLSF__FLAGS;
+}
+
+static inline
+void *
+tl_tlsf__to_ptr(TL_TlsfBlock *block)
+{
+    return (byte_t *)block + TL_TLSF__HEADER;
+}
+
+static inline
+TL_TlsfBlock *
+tl_tlsf__from_ptr(void *ptr)
+{
+    return (TL_TlsfBlock *)((byte_t *)ptr - TL_TLSF__HEADER);
+}
+
+static inline
+TL_TlsfBlock *
+tl_tlsf__next(TL_TlsfBlock *block)
+{
+    return (TL_TlsfBlock *)((byte_t *)tl_tlsf__to_ptr(block) + tl_tlsf__size(block));
+}
+
+/* Request size -> block payload size, or 0 when it cannot be served. */
+static inline
+size_t
+tl_tlsf__adjust(size_t size)
+{
+    if (size == 0 || size > TL_TLSF_MAX_SIZE) return 0;
+    size = tl_align_up(size, TL_TLSF_ALIGN);
+    return TL_MAX(size, TL_TLSF__BLOCK_MIN);
+}
+
+static inline
+void
+tl_tlsf__mapping(size_t size, int *fl, int *sl)
+{
+    if (size < TL_TLSF_SMALL_SIZE) {
+        *fl = 0;
+        *sl = (int)(size >> TL_TLSF_ALIGN_LOG2);
+    } else {
+        int bit = tl_tlsf__fls(size);
+        *sl = (int)(size >> (bit - TL_TLSF_SL_LOG2)) ^ TL_TLSF_SL_COUNT;
+        *fl = bit - (TL_TLSF_FL_SHIFT - 1);
+    }
+}
+
+static inline
+void
+tl_tlsf__insert(TL_TlsfAllocator *tlsf, TL_TlsfBlock *block)
+{
+    TL_TlsfBlock *head;
+    int fl, sl;
+
+    tl_tlsf__mapping(tl_tlsf__size(block), &fl, &sl);
+    head = tlsf->blocks[fl][sl];
+    block->prev_free = NULL;
+    block->next_free = head;
+    if (head) head->prev_free = block;
+    tlsf->blocks[fl][sl] = block;
+    tlsf->fl_bitmap |= 1U << fl;
+    tlsf->sl_bitmap[fl] |= 1U << sl;
+}
+
+static inline
+void
+tl_tlsf__remove(TL_TlsfAllocator *tlsf, TL_TlsfBlock *block)
+{
+    int fl, sl;
+
+    tl_tlsf__mapping(tl_tlsf__size(block), &fl, &sl);
+    if (block->next_free) block->next_free->prev_free = block->prev_free;
+    if (block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        tlsf->blocks[fl][sl] = block->next_free;
+        if (!block->next_free) {
+            tlsf->sl_bitmap[fl] &= ~(1U << sl);
+            if (!tlsf->sl_bitmap[fl]) tlsf->fl_bitmap &= ~(1U << fl);
+        }
+    }
+}
+
+/* Take a free block of at least `size` bytes off its list, or NULL. */
+static inline
+TL_TlsfBlock *
+tl_tlsf__locate(TL_TlsfAllocator *tlsf, size_t size)
+{
+    TL_TlsfBlock *block;
+    uint32_t sl_map;
+    int fl, sl;
+
+    /* round up to the next list so any block found is large enough */
+    if (size >= TL_TLSF_SMALL_SIZE) {
+        size += ((size_t)1 << (tl_tlsf__fls(size) - TL_TLSF_SL_LOG2)) - 1U;
+    }
+    tl_tlsf__mapping(size, &fl, &sl);
+    if (fl >= TL_TLSF_FL_COUNT) return NULL;
+
+    sl_map = tlsf->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        uint32_t fl_map = fl + 1 < 32 ? tlsf->fl_bitmap & (~0U << (fl + 1)) : 0;
+
+        if (!fl_map) return NULL;
+        fl = tl_tlsf__ffs(fl_map);
+        sl_map = tlsf->sl_bitmap[fl];
+    }
+    sl = tl_tlsf__ffs(sl_map);
+
+    block = tlsf->blocks[fl][sl];
+    tl_tlsf__remove(tlsf, block);
+    return block;
+}
+
+/* Mark `block` free in its own header and its successor's. */
+static inline
+void
+tl_tlsf__set_free(TL_TlsfBlock *block)
+{
+    TL_TlsfBlock *next = tl_tlsf__next(block);
+
+    block->size |= TL_TLSF__FREE;
+    next->size |= TL_TLSF__PREV_FREE;
+    next->prev_phys = block;
+}
+
+static inline
+void
+tl_tlsf__set_used(TL_TlsfBlock *block)
+{
+    block->size &= ~TL_TLSF__FREE;
+    tl_tlsf__next(block)->size &= ~TL_TLSF__PREV_FREE;
+}
+
+/* Split the used `block` to `size` payload bytes; the tail becomes a free
+ * block, merged with a free successor and listed. */
+static inline
+void
+tl_tlsf__trim(TL_TlsfAllocator *tlsf, TL_TlsfBlock *block, size_t size)
+{
+    TL_TlsfBlock *rest;
+    TL_TlsfBlock *next;
+    size_t total = tl_tlsf__size(block);
+
+    if (total < size + sizeof(TL_TlsfBlock)) return;
+
+    rest = (TL_TlsfBlock *)((byte_t *)tl_tlsf__to_ptr(block) + size);
+    rest->size = total - size - TL_TLSF__HEADER;
+    block->size = size | (block->size & TL_TLSF__FLAGS);
+
+    next = tl_tlsf__next(rest);
+    if (next->size & TL_TLSF__FREE) {
+        tl_tlsf__remove(tlsf, next);
+        rest->size += TL_TLSF__HEADER + tl_tlsf__size(next);
+    }
+    tl_tlsf__set_free(rest);
+    tl_tlsf__insert(tlsf, rest);
+}
+
+/*
+ * Manage `bytes` at `mem`. The region must outlive the allocator and is not
+ * freed by tl_tlsf_destroy(). At most TL_TLSF_MAX_SIZE * 2 bytes are used.
+ */
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_tlsf_init(TL_TlsfAllocator *tlsf, void *mem, size_t bytes)
+{
+    uintptr_t start;
+    uintptr_t end;
+    TL_TlsfBlock *block;
+    TL_TlsfBlock *sentinel;
+    size_t size;
+
+    assert(tlsf != NULL);
+    memset(tlsf, 0, sizeof(*tlsf));
+    if (!mem) return 0;
+
+    start = tl_align_up_ptr((uintptr_t)mem, TL_TLSF_ALIGN);
+    end = ((uintptr_t)mem + bytes) & ~(uintptr_t)(TL_TLSF_ALIGN - 1U);
+    if (start == 0 || end <= start || end - start < 2 * TL_TLSF__HEADER + TL_TLSF__BLOCK_MIN) return 0;
+
+    size = (size_t)(end - start) - 2 * TL_TLSF__HEADER;
+    size = TL_MIN(size, ((size_t)1 << TL_TLSF_FL_MAX) - TL_TLSF_ALIGN);
+
+    /* one free block spanning the region, then a zero-sized used sentinel */
+    block = (TL_TlsfBlock *)start;
+    block->size = size;
+    sentinel = tl_tlsf__next(block);
+    sentinel->size = 0;
+    tl_tlsf__set_free(block);
+    tl_tlsf__insert(tlsf, block);
+
+    tlsf->region = mem;
+    tlsf->region_size = bytes;
+    return 1;
+}
+
+/* Like tl_tlsf_init() over `bytes` of fresh pages owned by the allocator. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_tlsf_init_mapped(TL_TlsfAllocator *tlsf, size_t bytes)
+{
+    void *mem;
+
+    assert(tlsf != NULL);
+    if (bytes == 0) return 0;
+#if defined(TL_MEM__HAS_MMAP)
+    mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return 0;
+#else
+    mem = malloc(bytes);
+    if (!mem) return 0;
+#endif
+
+    if (!tl_tlsf_init(tlsf, mem, bytes)) {
+#if defined(TL_MEM__HAS_MMAP)
+        munmap(mem, bytes);
+#else
+        free(mem);
+#endif
+        return 0;
+    }
+    tlsf->mapped = 1;
+    return 1;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_tlsf_destroy(TL_TlsfAllocator *tlsf)
+{
+    if (!tlsf) return;
+    if (tlsf->mapped) {
+#if defined(TL_MEM__HAS_MMAP)
+        munmap(tlsf->region, tlsf->region_size);
+#else
+        free(tlsf->region);
+#endif
+    }
+    memset(tlsf, 0, sizeof(*tlsf));
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_tlsf_alloc(TL_TlsfAllocator *tlsf, size_t size, size_t align)
+{
+    TL_TlsfBlock *block;
+    size_t adjusted;
+
+    assert(tlsf != NULL);
+    align = tl_normalize_align(align);
+    adjusted = tl_tlsf__adjust(size);
+    if (align == 0 || adjusted == 0) return NULL;
+
+    if (align <= TL_TLSF_ALIGN) {
+        block = tl_tlsf__locate(tlsf, adjusted);
+        if (!block) return NULL;
+    } else {
+        /* over-allocate, then free a leading gap big enough to be a block */
+        size_t gap_min = sizeof(TL_TlsfBlock);
+        uintptr_t ptr;
+        uintptr_t aligned;
+        TL_TlsfBlock *lead;
+
+        if (adjusted > TL_TLSF_MAX_SIZE - gap_min || align > TL_TLSF_MAX_SIZE - gap_min - adjusted) return NULL;
+        lead = tl_tlsf__locate(tlsf, adjusted + align + gap_min);
+        if (!lead) return NULL;
+
+        ptr = (uintptr_t)tl_tlsf__to_ptr(lead);
+        aligned = tl_align_up_ptr(ptr, align);
+        if (aligned != ptr && aligned - ptr < gap_min) aligned = tl_align_up_ptr(ptr + gap_min, align);
+
+        block = lead;
+        if (aligned != ptr) {
+            block = tl_tlsf__from_ptr((void *)aligned);
+            block->size = (tl_tlsf__size(lead) - (size_t)(aligned - ptr)) | TL_TLSF__PREV_FREE;
+            block->prev_phys = lead;
+            lead->size = ((size_t)(aligned - ptr) - TL_TLSF__HEADER) | (lead->size & TL_TLSF__FLAGS);
+            tl_tlsf__insert(tlsf, lead);
+        }
+    }
+
+    tl_tlsf__set_used(block);
+    tl_tlsf__trim(tlsf, block, adjusted);
+    return tl_tlsf__to_ptr(block);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_tlsf_free(TL_TlsfAllocator *tlsf, void *ptr)
+{
+    TL_TlsfBlock *block;
+    TL_TlsfBlock *next;
+
+    if (!tlsf || !ptr) return;
+    block = tl_tlsf__from_ptr(ptr);
+    assert(!(block->size & TL_TLSF__FREE));
+
+    if (block->size & TL_TLSF__PREV_FREE) {
+        TL_TlsfBlock *prev = block->prev_phys;
+
+        tl_tlsf__remove(tlsf, prev);
+        prev->size += TL_TLSF__HEADER + tl_tlsf__size(block);
+        block = prev;
+    }
+    next = tl_tlsf__next(block);
+    if (next->size & TL_TLSF__FREE) {
+        tl_tlsf__remove(tlsf, next);
+        block->size += TL_TLSF__HEADER + tl_tlsf__size(next);
+    }
+    tl_tlsf__set_free(block);
+    tl_tlsf__insert(tlsf, block);
+}
+
+/* Grows into a free successor or shrinks in place; copies only otherwise. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_tlsf_realloc(TL_TlsfAllocator *tlsf,
+                void *ptr,
+                size_t old_size,
+                size_t new_size,
+                size_t align)
+{
+    TL_TlsfBlock *block;
+    TL_TlsfBlock *next;
+    size_t adjusted;
+    size_t current;
+    void *moved;
+
+    assert(tlsf != NULL);
+    if (!ptr) return tl_tlsf_alloc(tlsf, new_size, align);
+    if (new_size == 0) {
+        tl_tlsf_free(tlsf, ptr);
+        return NULL;
+    }
+
+    adjusted = tl_tlsf__adjust(new_size);
+    if (adjusted == 0) return NULL;
+    block = tl_tlsf__from_ptr(ptr);
+    current = tl_tlsf__size(block);
+    next = tl_tlsf__next(block);
+
+    if (adjusted > current && (next->size & TL_TLSF__FREE) &&
+        current + TL_TLSF__HEADER + tl_tlsf__size(next) >= adjusted) {
+        tl_tlsf__remove(tlsf, next);
+        block->size += TL_TLSF__HEADER + tl_tlsf__size(next);
+        tl_tlsf__set_used(block);
+        current = tl_tlsf__size(block);
+    }
+    if (adjusted <= current) {
+        tl_tlsf__trim(tlsf, block, adjusted);
+        return ptr;
+    }
+
+    moved = tl_tlsf_alloc(tlsf, new_size, align);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, TL_MIN(old_size, new_size));
+    tl_tlsf_free(tlsf, ptr);
+    return moved;
+}
+
+static inline
+void *
+tl_allocator_tlsf_alloc(void *ctx, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    return tl_tlsf_alloc((TL_TlsfAllocator *)ctx, size, align);
+}
+
+static inline
+void
+tl_allocator_tlsf_free(void *ctx, void *ptr, size_t size, size_t align)
+{
+    (void)size;
+    (void)align;
+    assert(ctx != NULL);
+    tl_tlsf_free((TL_TlsfAllocator *)ctx, ptr);
+}
+
+static inline
+void *
+tl_allocator_tlsf_realloc(void *ctx,
+                          void *ptr,
+                          size_t old_size,
+                          size_t new_size,
+                          size_t align)
+{
+    assert(ctx != NULL);
+    return tl_tlsf_realloc((TL_TlsfAllocator *)ctx, ptr, old_size, new_size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static const TL_AllocatorVTable tl_allocatorvt_tlsf = {
+    .alloc = tl_allocator_tlsf_alloc,
+    .free = tl_allocator_tlsf_free,
+    .realloc = tl_allocator_tlsf_realloc,
+};
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Allocator
+tl_get_allocator_tlsf(TL_TlsfAllocator *tlsf)
+{
+    return (TL_Allocator){
+        .vt = &tl_allocatorvt_tlsf,
+        .ctx = tlsf,
+    };
+}
+
+/* buddy allocator
+ *
+ * Power-of-two blocks from TL_BuddyAllocator.min_block up to max_block, split
+ * and merged with their buddies, over one region aligned to max_block. A
+ * block of order k starts at a multiple of its own size from the base, so
+ * every block is aligned to its size. Each order has a free list threaded
+ * through the free blocks and a bitmap with one bit per block position;
+ * on free the buddy's bit decides the merge without touching its memory.
+ *
+ * The order of a block is recomputed from the (size, align) passed to free
+ * and realloc, so blocks carry no header. Not thread-safe.
+ */
+
+#define TL_BUDDY_MAX_ORDERS 40
+
+typedef struct TL_BuddyNode {
+    struct TL_BuddyNode *next;
+    struct TL_BuddyNode *prev;
+} TL_BuddyNode;
+
+typedef struct TL_BuddyAllocator {
+    byte_t *base;                     /* aligned to max_block */
+    size_t size;                      /* multiple of max_block */
+    size_t min_block;
+    size_t max_block;
+    int min_shift;
+    int order_count;
+    uint64_t nonempty;                /* bit k: free_lists[k] is not empty */
+    TL_BuddyNode *free_lists[TL_BUDDY_MAX_ORDERS];
+    size_t bitmap_offset[TL_BUDDY_MAX_ORDERS];
+    uint64_t *bitmap;                 /* bit set: block is free at that order */
+    size_t free_bytes;
+    void *region;
+    size_t region_size;
+    b32_t mapped;                     /* region is owned and released by destroy */
+} TL_BuddyAllocator;
+
+static inline
+int
+tl_buddy__ctz64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int bit = 0;
+    while (!(x & 1U)) {
+        x >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+/* Order of the smallest block holding `size` bytes at `align`, or -1. */
+static inline
+int
+tl_buddy__order(const TL_BuddyAllocator *buddy, size_t size, size_t align)
+{
+    size_t need = TL_MAX(size, align);
+    int order = 0;
+
+    while (order < buddy->order_count && (buddy->min_block << order) < need) ++order;
+    return order < buddy->order_count ? order : -1;
+}
+
+static inline
+size_t
+tl_buddy__bit(const TL_BuddyAllocator *buddy, int order, size_t offset)
+{
+    return buddy->bitmap_offset[order] + (offset >> (buddy->min_shift + order));
+}
+
+static inline
+b32_t
+tl_buddy__is_free(const TL_BuddyAllocator *buddy, int order, size_t offset)
+{
+    size_t bit = tl_buddy__bit(buddy, order, offset);
+    return (buddy->bitmap[bit / 64] >> (bit % 64)) & 1U;
+}
+
+static inline
+void
+tl_buddy__push(TL_BuddyAllocator *buddy, int order, size_t offset)
+{
+    TL_BuddyNode *node = (TL_BuddyNode *)(buddy->base + offset);
+    size_t bit = tl_buddy__bit(buddy, order, offset);
+
+    node->prev = NULL;
+    node->next = buddy->free_lists[order];
+    if (node->next) node->next->prev = node;
+    buddy->free_lists[order] = node;
+    buddy->nonempty |= (uint64_t)1 << order;
+    buddy->bitmap[bit / 64] |= (uint64_t)1 << (bit % 64);
+    buddy->free_bytes += buddy->min_block << order;
+}
+
+static inline
+void
+tl_buddy__remove(TL_BuddyAllocator *buddy, int order, size_t offset)
+{
+    TL_BuddyNode *node = (TL_BuddyNode *)(buddy->base + offset);
+    size_t bit = tl_buddy__bit(buddy, order, offset);
+
+    if (node->next) node->next->prev = node->prev;
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        buddy->free_lists[order] = node->next;
+        if (!node->next) buddy->nonempty &= ~((uint64_t)1 << order);
+    }
+    buddy->bitmap[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+    buddy->free_bytes -= buddy->min_block << order;
+}
+
+/*
+ * Manage `bytes` at `mem` in blocks of `min_block`..`max_block` bytes (both
+ * powers of two, min_block >= 2 * sizeof(void *)). Only whole max_block
+ * blocks past the first max_block-aligned address are used. The region
+ * must outlive the allocator and is not freed by tl_buddy_destroy().
+ */
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_buddy_init(TL_BuddyAllocator *buddy,
+              void *mem,
+              size_t bytes,
+              size_t min_block,
+              size_t max_block)
+{
+    uintptr_t start;
+    size_t bits = 0;
+    size_t offset;
+    int order;
+
+    assert(buddy != NULL);
+    memset(buddy, 0, sizeof(*buddy));
+    if (!mem || min_block < sizeof(TL_BuddyNode) || max_block < min_block) return 0;
+    if (!tl_is_power_of_two(min_block) || !tl_is_power_of_two(max_block)) return 0;
+
+    buddy->min_block = min_block;
+    buddy->max_block = max_block;
+    while (((size_t)1 << buddy->min_shift) < min_block) ++buddy->min_shift;
+    while ((min_block << buddy->order_count) < max_block) ++buddy->order_count;
+    ++buddy->order_count;
+    if (buddy->order_count > TL_BUDDY_MAX_ORDERS) return 0;
+
+    start = tl_align_up_ptr((uintptr_t)mem, max_block);
+    if (start == 0 || start < (uintptr_t)mem || start - (uintptr_t)mem >= bytes) return 0;
+    buddy->base = (byte_t *)start;
+    buddy->size = (bytes - (size_t)(start - (uintptr_t)mem)) & ~(max_block - 1U);
+    if (buddy->size == 0) return 0;
+
+    for (order = 0; order < buddy->order_count; ++order) {
+        buddy->bitmap_offset[order] = bits;
+        bits += buddy->size >> (buddy->min_shift + order);
+    }
+    buddy->bitmap = (uint64_t *)calloc((bits + 63) / 64, sizeof(uint64_t));
+    if (!buddy->bitmap) return 0;
+
+    for (offset = 0; offset < buddy->size; offset += max_block) {
+        tl_buddy__push(buddy, buddy->order_count - 1, offset);
+    }
+    buddy->region = mem;
+    buddy->region_size = bytes;
+    return 1;
+}
+
+/* Like tl_buddy_init() over `bytes` of fresh pages owned by the allocator;
+ * pages are committed by the OS on first touch. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_buddy_init_mapped(TL_BuddyAllocator *buddy,
+                     size_t bytes,
+                     size_t min_block,
+                     size_t max_block)
+{
+    size_t total;
+    void *mem;
+
+    assert(buddy != NULL);
+    memset(buddy, 0, sizeof(*buddy));
+    if (bytes == 0 || !tl_is_power_of_two(max_block)) return 0;
+    bytes = tl_align_up(bytes, max_block);
+    if (bytes == 0 || bytes > SIZE_MAX - max_block) return 0;
+    total = bytes + max_block; /* room to align the base */
+
+#if defined(TL_MEM__HAS_MMAP)
+    mem = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return 0;
+#else
+    mem = malloc(total);
+    if (!mem) return 0;
+#endif
+
+    if (!tl_buddy_init(buddy, mem, total, min_block, max_block)) {
+#if defined(TL_MEM__HAS_MMAP)
+        munmap(mem, total);
+#else
+        free(mem);
+#endif
+        return 0;
+    }
+    buddy->mapped = 1;
+    return 1;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_buddy_destroy(TL_BuddyAllocator *buddy)
+{
+    if (!buddy) return;
+    free(buddy->bitmap);
+    if (buddy->mapped) {
+#if defined(TL_MEM__HAS_MMAP)
+        munmap(buddy->region, buddy->region_size);
+#else
+        free(buddy->region);
+#endif
+    }
+    memset(buddy, 0, sizeof(*buddy));
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_buddy_alloc(TL_BuddyAllocator *buddy, size_t size, size_t align)
+{
+    uint64_t candidates;
+    size_t offset;
+    int order;
+    int k;
+
+    assert(buddy != NULL);
+    align = tl_normalize_align(align);
+    if (align == 0 || size == 0) return NULL;
+    order = tl_buddy__order(buddy, size, align);
+    if (order < 0) return NULL;
+
+    candidates = buddy->nonempty & (~(uint64_t)0 << order);
+    if (!candidates) return NULL;
+    k = tl_buddy__ctz64(candidates);
+
+    offset = (size_t)((byte_t *)buddy->free_lists[k] - buddy->base);
+    tl_buddy__remove(buddy, k, offset);
+    while (k > order) {
+        --k;
+        tl_buddy__push(buddy, k, offset + (buddy->min_block << k));
+    }
+    return buddy->base + offset;
+}
+
+/* Free the order-`order` block at `offset`, merging with free buddies. */
+static inline
+void
+tl_buddy__release(TL_BuddyAllocator *buddy, size_t offset, int order)
+{
+    while (order < buddy->order_count - 1) {
+        size_t other = offset ^ (buddy->min_block << order);
+
+        if (!tl_buddy__is_free(buddy, order, other)) break;
+        tl_buddy__remove(buddy, order, other);
+        offset &= ~(buddy->min_block << order);
+        ++order;
+    }
+    tl_buddy__push(buddy, order, offset);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_buddy_free(TL_BuddyAllocator *buddy, void *ptr, size_t size, size_t align)
+{
+    size_t offset;
+    int order;
+
+    if (!buddy || !ptr) return;
+    align = tl_normalize_align(align);
+    order = tl_buddy__order(buddy, size, align);
+    assert(order >= 0);
+    if (order < 0) return;
+
+    offset = (size_t)((byte_t *)ptr - buddy->base);
+    assert(offset < buddy->size && (offset & ((buddy->min_block << order) - 1U)) == 0);
+    assert(!tl_buddy__is_free(buddy, order, offset) && "buddy: double free");
+    tl_buddy__release(buddy, offset, order);
+}
+
+/* Shrinks in place by freeing the upper halves; grows in place while the
+ * block is a left buddy and its right buddy is free; copies otherwise. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_buddy_realloc(TL_BuddyAllocator *buddy,
+                 void *ptr,
+                 size_t old_size,
+                 size_t new_size,
+                 size_t align)
+{
+    size_t offset;
+    int old_order;
+    int new_order;
+    int k;
+    void *moved;
+
+    assert(buddy != NULL);
+    if (!ptr) return tl_buddy_alloc(buddy, new_size, align);
+    if (new_size == 0) {
+        tl_buddy_free(buddy, ptr, old_size, align);
+        return NULL;
+    }
+
+    align = tl_normalize_align(align);
+    if (align == 0) return NULL;
+    old_order = tl_buddy__order(buddy, old_size, align);
+    new_order = tl_buddy__order(buddy, new_size, align);
+    assert(old_order >= 0);
+    offset = (size_t)((byte_t *)ptr - buddy->base);
+
+    if (new_order >= 0 && new_order <= old_order) {
+        for (k = old_order; k > new_order; --k) {
+            tl_buddy__release(buddy, offset + (buddy->min_block << (k - 1)), k - 1);
+        }
+        return ptr;
+    }
+
+    if (new_order >= 0) {
+        for (k = old_order; k < new_order; ++k) {
+            size_t block = buddy->min_block << k;
+            if ((offset & block) || !tl_buddy__is_free(buddy, k, offset + block)) break;
+        }
+        if (k == new_order) {
+            for (k = old_order; k < new_order; ++k) {
+                tl_buddy__remove(buddy, k, offset + (buddy->min_block << k));
+            }
+            return ptr;
+        }
+    }
+
+    moved = tl_buddy_alloc(buddy, new_size, align);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, TL_MIN(old_size, new_size));
+    tl_buddy_free(buddy, ptr, old_size, align);
+    return moved;
+}
+
+static inline
+void *
+tl_allocator_buddy_alloc(void *ctx, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    return tl_buddy_alloc((TL_BuddyAllocator *)ctx, size, align);
+}
+
+static inline
+void
+tl_allocator_buddy_free(void *ctx, void *ptr, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    tl_buddy_free((TL_BuddyAllocator *)ctx, ptr, size, align);
+}
+
+static inline
+void *
+tl_allocator_buddy_realloc(void *ctx,
+                           void *ptr,
+                           size_t old_size,
+                           size_t new_size,
+                           size_t align)
+{
+    assert(ctx != NULL);
+    return tl_buddy_realloc((TL_BuddyAllocator *)ctx, ptr, old_size, new_size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static const TL_AllocatorVTable tl_allocatorvt_buddy = {
+    .alloc = tl_allocator_buddy_alloc,
+    .free = tl_allocator_buddy_free,
+    .realloc = tl_allocator_buddy_realloc,
+};
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Allocator
+tl_get_allocator_buddy(TL_BuddyAllocator *buddy)
+{
+    return (TL_Allocator){
+        .vt = &tl_allocatorvt_buddy,
+        .ctx = buddy,
+    };
+}
+
+/* stack (LIFO) allocator
+ *
+ * Bump allocation over one buffer where every block is preceded by a small
+ * header linking it to the block below. Freeing the top block pops it, and
+ * blocks freed out of order are popped together with the first top block
+ * freed after them, so memory is reused as soon as the LIFO order allows.
+ * realloc of the top block resizes it in place. Not thread-safe.
+ */
+
+#define TL_STACK__NONE SIZE_MAX
+
+typedef struct TL_StackHeader {
+    size_t prev_top;                  /* stack top before this block */
+    size_t prev_block;                /* header offset of the block below */
+    size_t freed;                     /* freed while not on top */
+} TL_StackHeader;
+
+typedef struct TL_StackAlloc {
+    byte_t *buf;
+    size_t cap;
+    size_t top;                       /* bytes in use */
+    size_t last;                      /* header offset of the top block */
+    b32_t owned;                      /* buf is released by destroy */
+} TL_StackAlloc;
+
+/* Use `bytes` at `mem`; the buffer is not freed by tl_stack_destroy(). */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_stack_init(TL_StackAlloc *stack, void *mem, size_t bytes)
+{
+    assert(stack != NULL);
+    stack->buf = (byte_t *)mem;
+    stack->cap = mem ? bytes : 0;
+    stack->top = 0;
+    stack->last = TL_STACK__NONE;
+    stack->owned = 0;
+}
+
+/* Like tl_stack_init() over a heap buffer of `bytes` owned by the stack. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+b32_t
+tl_stack_init_owned(TL_StackAlloc *stack, size_t bytes)
+{
+    void *mem;
+
+    assert(stack != NULL);
+    mem = bytes ? malloc(bytes) : NULL;
+    tl_stack_init(stack, mem, bytes);
+    if (!mem) return 0;
+    stack->owned = 1;
+    return 1;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_stack_destroy(TL_StackAlloc *stack)
+{
+    if (!stack) return;
+    if (stack->owned) free(stack->buf);
+    tl_stack_init(stack, NULL, 0);
+}
+
+static inline
+TL_StackHeader *
+tl_stack__header(const TL_StackAlloc *stack, size_t offset)
+{
+    return (TL_StackHeader *)(stack->buf + offset);
+}
+
+/* Header offset of the block at `ptr` when it is the top block, else NONE. */
+static inline
+size_t
+tl_stack__top_of(const TL_StackAlloc *stack, const void *ptr)
+{
+    if (stack->last == TL_STACK__NONE) return TL_STACK__NONE;
+    if ((const byte_t *)ptr != stack->buf + stack->last + sizeof(TL_StackHeader)) return TL_STACK__NONE;
+    return stack->last;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_stack_alloc(TL_StackAlloc *stack, size_t size, size_t align)
+{
+    TL_StackHeader *header;
+    uintptr_t base;
+    uintptr_t payload;
+    size_t offset;
+
+    assert(stack != NULL);
+    align = tl_normalize_align(align);
+    if (align == 0 || size == 0 || !stack->buf) return NULL;
+
+    base = (uintptr_t)stack->buf;
+    payload = tl_align_up_ptr(base + stack->top + sizeof(TL_StackHeader), align);
+    if (payload == 0 || payload < base) return NULL;
+    offset = (size_t)(payload - base);
+    if (offset > stack->cap || size > stack->cap - offset) return NULL;
+
+    header = (TL_StackHeader *)(payload - sizeof(TL_StackHeader));
+    header->prev_top = stack->top;
+    header->prev_block = stack->last;
+    header->freed = 0;
+
+    stack->last = offset - sizeof(TL_StackHeader);
+    stack->top = offset + size;
+    return (void *)payload;
+}
+
+/* Pop the top block and any already-freed blocks right below it. */
+static inline
+void
+tl_stack__pop(TL_StackAlloc *stack)
+{
+    TL_StackHeader *header;
+
+    do {
+        header = tl_stack__header(stack, stack->last);
+        stack->top = header->prev_top;
+        stack->last = header->prev_block;
+    } while (stack->last != TL_STACK__NONE && tl_stack__header(stack, stack->last)->freed);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_stack_free(TL_StackAlloc *stack, void *ptr)
+{
+    TL_StackHeader *header;
+
+    if (!stack || !ptr) return;
+    assert((byte_t *)ptr > stack->buf && (byte_t *)ptr <= stack->buf + stack->top);
+
+    if (tl_stack__top_of(stack, ptr) != TL_STACK__NONE) {
+        tl_stack__pop(stack);
+        return;
+    }
+    header = (TL_StackHeader *)ptr - 1;
+    assert(!header->freed && "stack: double free");
+    header->freed = 1;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_stack_realloc(TL_StackAlloc *stack,
+                 void *ptr,
+                 size_t old_size,
+                 size_t new_size,
+                 size_t align)
+{
+    void *moved;
+
+    assert(stack != NULL);
+    if (!ptr) return tl_stack_alloc(stack, new_size, align);
+    if (new_size == 0) {
+        tl_stack_free(stack, ptr);
+        return NULL;
+    }
+
+    if (tl_stack__top_of(stack, ptr) != TL_STACK__NONE) {
+        size_t offset = (size_t)((byte_t *)ptr - stack->buf);
+
+        if (new_size <= stack->cap - offset) {
+            stack->top = offset + new_size;
+            return ptr;
+        }
+        return NULL;
+    }
+
+    moved = tl_stack_alloc(stack, new_size, align);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, TL_MIN(old_size, new_size));
+    tl_stack_free(stack, ptr);
+    return moved;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_stack_reset(TL_StackAlloc *stack)
+{
+    assert(stack != NULL);
+    stack->top = 0;
+    stack->last = TL_STACK__NONE;
+}
+
+static inline
+void *
+tl_allocator_stack_alloc(void *ctx, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    return tl_stack_alloc((TL_StackAlloc *)ctx, size, align);
+}
+
+static inline
+void
+tl_allocator_stack_free(void *ctx, void *ptr, size_t size, size_t align)
+{
+    (void)size;
+    (void)align;
+    assert(ctx != NULL);
+    tl_stack_free((TL_StackAlloc *)ctx, ptr);
+}
+
+static inline
+void *
+tl_allocator_stack_realloc(void *ctx,
+                           void *ptr,
+                           size_t old_size,
+                           size_t new_size,
+                           size_t align)
+{
+    assert(ctx != NULL);
+    return tl_stack_realloc((TL_StackAlloc *)ctx, ptr, old_size, new_size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static const TL_AllocatorVTable tl_allocatorvt_stack = {
+    .alloc = tl_allocator_stack_alloc,
+    .free = tl_allocator_stack_free,
+    .realloc = tl_allocator_stack_realloc,
+};
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Allocator
+tl_get_allocator_stack(TL_StackAlloc *stack)
+{
+    return (TL_Allocator){
+        .vt = &tl_allocatorvt_stack,
+        .ctx = stack,
+    };
+}
+
+/* tracking allocator
+ *
+ * Decorator that forwards to an inner allocator and records live and peak
+ * bytes, call counts and a size histogram in a TL_AllocStats. Each block
+ * gets a small header in front of it holding its size and call site, so
+ * frees are attributed to the site that allocated the block, and sized
+ * frees that do not match the allocation are caught by assert.
+ *
+ * Call sites are recorded by the TL_ALLOC / TL_ALLOC_ALIGNED / TL_REALLOC
+ * macros. Allocations made through the plain tl_allocator_* calls (e.g. by
+ * tl_arr_* and TL_Map) land on the "(unknown)" site; give each container
+ * its own TL_AllocStats to tell them apart. Not thread-safe.
+ */
+
+#define TL_ALLOC_STATS_BUCKETS 16 /* <=16B, <=32B, ..., <=256KB, larger */
+#define TL_ALLOC_STATS_SITES   64 /* site 0 collects unknown and overflow */
+
+typedef struct TL_AllocSite {
+    const char *file;
+    int line;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t live_count;
+    size_t alloc_count;
+} TL_AllocSite;
+
+typedef struct TL_AllocStats {
+    const char *name;                 /* optional, shown in the report */
+    TL_Allocator *inner;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t total_bytes;               /* sizes at alloc; reallocs move live/peak only */
+    size_t live_count;
+    size_t alloc_count;
+    size_t free_count;
+    size_t realloc_count;
+    size_t failed_count;
+    size_t buckets[TL_ALLOC_STATS_BUCKETS]; /* alloc sizes, sums to alloc_count */
+    size_t site_count;
+    TL_AllocSite sites[TL_ALLOC_STATS_SITES];
+} TL_AllocStats;
+
+typedef struct TL_TrackingHeader {
+    size_t size;
+    size_t site;
+} TL_TrackingHeader;
+
+static inline
+size_t
+tl_tracking__offset(size_t align)
+{
+    return tl_align_up(sizeof(TL_TrackingHeader), align);
+}
+
+static inline
+TL_TrackingHeader *
+tl_tracking__header(void *ptr)
+{
+    return (TL_TrackingHeader *)ptr - 1;
+}
+
+static inline
+size_t
+tl_tracking__bucket(size_t size)
+{
+    size_t bucket = 0;
+
+    while (size > ((size_t)16 << bucket) && bucket < TL_ALLOC_STATS_BUCKETS - 1) ++bucket;
+    return bucket;
+}
+
+static inline
+size_t
+tl_tracking__site(TL_AllocStats *stats, const char *file, int line)
+{
+    size_t i;
+
+    if (!file) return 0;
+    for (i = 1; i < stats->site_count; ++i) {
+        if (stats->sites[i].line == line && stats->sites[i].file == file) return i;
+    }
+    for (i = 1; i < stats->site_count; ++i) {
+        if (stats->sites[i].line == line && strcmp(stats->sites[i].file, file) == 0) return i;
+    }
+    if (stats->site_count >= TL_ALLOC_STATS_SITES) return 0;
+
+    i = stats->site_count++;
+    stats->sites[i].file = file;
+    stats->sites[i].line = line;
+    return i;
+}
+
+static inline
+void
+tl_tracking__add_live(TL_AllocStats *stats, size_t site, size_t size)
+{
+    TL_AllocSite *s = &stats->sites[site];
+
+    stats->live_bytes += size;
+    stats->peak_bytes = TL_MAX(stats->peak_bytes, stats->live_bytes);
+
+    s->live_bytes += size;
+    s->peak_bytes = TL_MAX(s->peak_bytes, s->live_bytes);
+}
+
+static inline
+void
+tl_tracking__add(TL_AllocStats *stats, size_t site, size_t size)
+{
+    stats->total_bytes += size;
+    ++stats->buckets[tl_tracking__bucket(size)];
+    tl_tracking__add_live(stats, site, size);
+}
+
+static inline
+void
+tl_tracking__sub(TL_AllocStats *stats, size_t site, size_t size)
+{
+    stats->live_bytes -= size;
+    stats->sites[site].live_bytes -= size;
+}
+
+static inline
+void *
+tl_tracking__alloc(TL_AllocStats *stats,
+                   size_t size,
+                   size_t align,
+                   const char *file,
+                   int line)
+{
+    TL_TrackingHeader *header;
+    size_t offset;
+    size_t site;
+    byte_t *raw;
+
+    align = tl_normalize_align(align);
+    if (align == 0 || size == 0) return NULL;
+    offset = tl_tracking__offset(align);
+    if (size > SIZE_MAX - offset) return NULL;
+
+    raw = (byte_t *)tl_allocator_alloc_aligned(stats->inner, size + offset, align);
+    if (!raw) {
+        ++stats->failed_count;
+        return NULL;
+    }
+
+    site = tl_tracking__site(stats, file, line);
+    header = tl_tracking__header(raw + offset);
+    header->size = size;
+    header->site = site;
+
+    ++stats->alloc_count;
+    ++stats->live_count;
+    ++stats->sites[site].alloc_count;
+    ++stats->sites[site].live_count;
+    tl_tracking__add(stats, site, size);
+    return raw + offset;
+}
+
+static inline
+void *
+tl_tracking__realloc(TL_AllocStats *stats,
+                     void *ptr,
+                     size_t old_size,
+                     size_t new_size,
+                     size_t align,
+                     const char *file,
+                     int line)
+{
+    TL_TrackingHeader *header;
+    TL_TrackingHeader saved;
+    size_t offset;
+    byte_t *raw;
+
+    if (!ptr) return tl_tracking__alloc(stats, new_size, align, file, line);
+    align = tl_normalize_align(align);
+    if (align == 0) return NULL;
+
+    header = tl_tracking__header(ptr);
+    assert(header->size == old_size && "tracking: realloc size does not match the allocation");
+    (void)old_size;
+    saved = *header;
+    offset = tl_tracking__offset(align);
+
+    if (new_size == 0) {
+        tl_tracking__sub(stats, saved.site, saved.size);
+        --stats->live_count;
+        --stats->sites[saved.site].live_count;
+        ++stats->free_count;
+        tl_allocator_free_aligned(stats->inner, (byte_t *)ptr - offset, saved.size + offset, align);
+        return NULL;
+    }
+    if (new_size > SIZE_MAX - offset) return NULL;
+
+    raw = (byte_t *)tl_allocator_realloc_aligned(stats->inner, (byte_t *)ptr - offset,
+                                                 saved.size + offset, new_size + offset, align);
+    if (!raw) {
+        ++stats->failed_count;
+        return NULL;
+    }
+
+    /* the block keeps the site that allocated it */
+    tl_tracking__header(raw + offset)->size = new_size;
+    ++stats->realloc_count;
+    tl_tracking__sub(stats, saved.site, saved.size);
+    tl_tracking__add_live(stats, saved.site, new_size);
+    return raw + offset;
+}
+
+static inline
+void *
+tl_allocator_tracking_alloc(void *ctx, size_t size, size_t align)
+{
+    assert(ctx != NULL);
+    return tl_tracking__alloc((TL_AllocStats *)ctx, size, align, NULL, 0);
+}
+
+static inline
+void
+tl_allocator_tracking_free(void *ctx, void *ptr, size_t size, size_t align)
+{
+    TL_AllocStats *stats = (TL_AllocStats *)ctx;
+    TL_TrackingHeader *header;
+    size_t offset;
+
+    assert(ctx != NULL);
+    if (!ptr) return;
+    align = tl_normalize_align(align);
+    if (align == 0) return;
+
+    header = tl_tracking__header(ptr);
+    assert(header->size == size && "tracking: free size does not match the allocation");
+    (void)size;
+    offset = tl_tracking__offset(align);
+
+    tl_tracking__sub(stats, header->site, header->size);
+    --stats->live_count;
+    --stats->sites[header->site].live_count;
+    ++stats->free_count;
+    tl_allocator_free_aligned(stats->inner, (byte_t *)ptr - offset, header->size + offset, align);
+}
+
+static inline
+void *
+tl_allocator_tracking_realloc(void *ctx,
+                              void *ptr,
+                              size_t old_size,
+                              size_t new_size,
+                              size_t align)
+{
+    assert(ctx != NULL);
+    return tl_tracking__realloc((TL_AllocStats *)ctx, ptr, old_size, new_size, align, NULL, 0);
+}
+
+static inline
+void *
+tl_allocator_tracking_alloc_at(void *ctx, size_t size, size_t align, const char *file, int line)
+{
+    assert(ctx != NULL);
+    return tl_tracking__alloc((TL_AllocStats *)ctx, size, align, file, line);
+}
+
+static inline
+void *
+tl_allocator_tracking_realloc_at(void *ctx,
+                                 void *ptr,
+                                 size_t old_size,
+                                 size_t new_size,
+                                 size_t align,
+                                 const char *file,
+                                 int line)
+{
+    assert(ctx != NULL);
+    return tl_tracking__realloc((TL_AllocStats *)ctx, ptr, old_size, new_size, align, file, line);
+}
+
+/* static, so each translation unit has its own copy: tracking allocators are
+ * recognised by their alloc_at slot, never by comparing vt pointers */
+TL_ATTR_MAYBE_UNUSED
+static const TL_AllocatorVTable tl_allocatorvt_tracking = {
+    .alloc = tl_allocator_tracking_alloc,
+    .free = tl_allocator_tracking_free,
+    .realloc = tl_allocator_tracking_realloc,
+    .alloc_at = tl_allocator_tracking_alloc_at,
+    .realloc_at = tl_allocator_tracking_realloc_at,
+};
+
+/* Wrap `inner`; `stats` is zeroed (name kept) and must outlive the result. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Allocator
+tl_get_allocator_tracking(TL_Allocator *inner, TL_AllocStats *stats)
+{
+    const char *name;
+
+    assert(inner != NULL && stats != NULL);
+    name = stats->name;
+    memset(stats, 0, sizeof(*stats));
+    stats->name = name;
+    stats->inner = inner;
+    stats->site_count = 1;
+    stats->sites[0].file = "(unknown)";
+    return (TL_Allocator){
+        .vt = &tl_allocatorvt_tracking,
+        .ctx = stats,
+    };
+}
+
+/* Like tl_allocator_alloc_aligned(), recording `file`:`line` when tracked. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_allocator_alloc_at(TL_Allocator *allocator,
+                      size_t size,
+                      size_t align,
+                      const char *file,
+                      int line)
+{
+    if (allocator->vt->alloc_at) return allocator->vt->alloc_at(allocator->ctx, size, align, file, line);
+    return tl_allocator_alloc_aligned(allocator, size, align);
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void *
+tl_allocator_realloc_at(TL_Allocator *allocator,
+                        void *ptr,
+                        size_t old_size,
+                        size_t new_size,
+                        size_t align,
+                        const char *file,
+                        int line)
+{
+    if (allocator->vt->realloc_at) {
+        return allocator->vt->realloc_at(allocator->ctx, ptr, old_size, new_size, align, file, line);
+    }
+    return tl_allocator_realloc_aligned(allocator, ptr, old_size, new_size, align);
+}
+
+#define TL_ALLOC(allocator, size) \
+    tl_allocator_alloc_at((allocator), (size), TL_MEM_ALIGN, __FILE__, __LINE__)
+#define TL_ALLOC_ALIGNED(allocator, size, align) \
+    tl_allocator_alloc_at((allocator), (size), (align), __FILE__, __LINE__)
+#define TL_REALLOC(allocator, ptr, old_size, new_size) \
+    tl_allocator_realloc_at((allocator), (ptr), (old_size), (new_size), TL_MEM_ALIGN, __FILE__, __LINE__)
+
+/*
+ * Write the stats through tinylib logging at `level`: totals, the non-empty
+ * size buckets, then call sites by live bytes, largest first.
+ */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_alloc_stats_report(const TL_AllocStats *stats, TL_LogLevel level)
+{
+    size_t order[TL_ALLOC_STATS_SITES];
+    size_t i, j;
+
+    if (!stats || !tl_log_is_enabled(level)) return;
+
+    tl_log_write(level, __FILE__, __LINE__, __func__,
+                 "alloc stats %s: live %zu B in %zu blocks, peak %zu B, total %zu B; "
+                 "%zu allocs, %zu reallocs, %zu frees, %zu failed",
+                 stats->name ? stats->name : "", stats->live_bytes, stats->live_count,
+                 stats->peak_bytes, stats->total_bytes, stats->alloc_count,
+                 stats->realloc_count, stats->free_count, stats->failed_count);
+
+    for (i = 0; i < TL_ALLOC_STATS_BUCKETS; ++i) {
+        if (!stats->buckets[i]) continue;
+        if (i + 1 < TL_ALLOC_STATS_BUCKETS) {
+            tl_log_write(level, __FILE__, __LINE__, __func__, "  <= %8zu B: %zu",
+                         (size_t)16 << i, stats->buckets[i]);
+        } else {
+            tl_log_write(level, __FILE__, __LINE__, __func__, "  >  %8zu B: %zu",
+                         (size_t)16 << (i - 1), stats->buckets[i]);
+        }
+    }
+
+    /* insertion sort by live bytes; at most TL_ALLOC_STATS_SITES entries */
+    for (i = 0; i < stats->site_count; ++i) {
+        for (j = i; j > 0 && stats->sites[order[j - 1]].live_bytes < stats->sites[i].live_bytes; --j) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for (i = 0; i < stats->site_count; ++i) {
+        const TL_AllocSite *s = &stats->sites[order[i]];
+
+        if (!s->alloc_count) continue;
+        tl_log_write(level, __FILE__, __LINE__, __func__,
+                     "  %s:%d: live %zu B in %zu blocks, peak %zu B, %zu allocs",
+                     s->file, s->line, s->live_bytes, s->live_count, s->peak_bytes, s->alloc_count);
+    }
+}
+
+TL_ATTR_MAYBE_UNUSED
+static const TL_Allocator tl_default_allocator = (TL_Allocator){
+    .vt = &tl_allocatorvt_std,
+    .ctx = NULL,
+};
+
+/* per-thread scratch arenas
+ *
+ * Each thread owns TL_SCRATCH_ARENA_COUNT long-lived arenas (one set per
+ * translation unit, as the storage is a static in this header). A scratch
+ * scope marks one of them on entry and restores it on exit, so after the
+ * first use a scope's chunks come back off the arena's free list and
+ * temporary work makes no heap calls.
+ *
+ * Pass the arenas a scope must not touch, typically the arena the caller
+ * returns results in, which may itself be a scratch arena of an outer
+ * scope. Scopes without conflicts simply nest on the same arena.
+ */
+
+#define TL_SCRATCH_ARENA_COUNT 2
+
+typedef struct TL_Scratch {
+    TL_Arena *arena;
+    TL_ArenaMark mark;
+} TL_Scratch;
+
+static inline
+TL_Arena *
+tl_scratch__arenas(void)
+{
+    static TL_THREAD_LOCAL TL_Arena arenas[TL_SCRATCH_ARENA_COUNT];
+    return arenas;
+}
+
+/* Mark the first scratch arena not listed in `conflicts`. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+TL_Scratch
+tl_scratch_begin(const TL_Arena *const *conflicts, size_t conflict_count)
+{
+    TL_Arena *arenas = tl_scratch__arenas();
+    TL_Scratch scratch = {0};
+    size_t i, j;
+
+    for (i = 0; i < TL_SCRATCH_ARENA_COUNT && !scratch.arena; ++i) {
+        scratch.arena = &arenas[i];
+        for (j = 0; j < conflict_count; ++j) {
+            if (conflicts[j] == &arenas[i]) {
+                scratch.arena = NULL;
+                break;
+            }
+        }
+    }
+    assert(scratch.arena != NULL && "every scratch arena is excluded; raise TL_SCRATCH_ARENA_COUNT");
+    if (scratch.arena) scratch.mark = tl_arena_mark(scratch.arena);
+    return scratch;
+}
+
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_scratch_end(TL_Scratch *scratch)
+{
+    assert(scratch != NULL);
+    if (!scratch->arena) return;
+    tl_arena_restore(scratch->arena, scratch->mark);
+    scratch->arena = NULL;
+}
+
+/* Free the calling thread's scratch chunks, e.g. before the thread exits. */
+TL_ATTR_MAYBE_UNUSED
+static inline
+void
+tl_scratch_release(void)
+{
+    TL_Arena *arenas = tl_scratch__arenas();
+    size_t i;
+
+    for (i = 0; i < TL_SCRATCH_ARENA_COUNT; ++i) tl_arena_destroy(&arenas[i]);
+}
+
+/*
+ * TL_TEMP_SCOPE(tmp) { ... tl_arena_alloc(tmp, n) ... }
+ *
+ * `tmp` is a TL_Arena * to a scratch arena; everything allocated from it is
+ * released when the block exits (including through `break`, but not
+ * `return` or `goto` out of it). TL_TEMP_SCOPE_EXCLUDING picks an arena
+ * other than `conflict`.
+ */
+#define TL_TEMP_SCOPE_EXCLUDING(arena_name, conflict) \
+    for (TL_Scratch tl__scratch_##arena_name = \
+             tl_scratch_begin((const TL_Arena *const[]){ (conflict) }, 1); \
+         tl__scratch_##arena_name.arena; \
+         tl_scratch_end(&tl__scratch_##arena_name)) \
+        for (TL_Arena *arena_name = tl__scratch_##arena_name.arena; arena_name; arena_name = NULL)
+
+#define TL_TEMP_SCOPE(arena_name) TL_TEMP_SCOPE_EXCLUDING(arena_name, NULL)
+
+#if defined(TL_MEM_SHORT_NAMES) || defined(TL_SHORT_NAMES)
+#define TEMP_SCOPE TL_TEMP_SCOPE
+#define TEMP_SCOPE_EXCLUDING TL_TEMP_SCOPE_EXCLUDING
+
+typedef TL_Allocator       Allocator;
+typedef TL_AllocatorVTable AllocatorVTable;
+typedef TL_ArenaChunk      ArenaChunk;
+typedef TL_Arena           Arena;
+typedef TL_ArenaMark       ArenaMark;
+typedef TL_Scratch         Scratch;
+typedef TL_FixedPool       FixedPool;
+typedef TL_SlabAllocator   SlabAllocator;
+typedef TL_TlsfAllocator   TlsfAllocator;
+typedef TL_BuddyAllocator  BuddyAllocator;
+typedef TL_StackAlloc      StackAlloc;
+typedef TL_AllocStats      AllocStats;
+typedef TL_AllocSite       AllocSite;
+#if defined(TL_HAS_CONCURRENT_POOL)
+typedef TL_ConcurrentFixedPool ConcurrentFixedPool;
+#endif
 #endif
 
 #endif /* TINYLIB_MEM_H */